@@ -5,10 +5,25 @@
 #define VULKANSURFER_H
 
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <functional>
+#include <memory>
+#include <new>
 #include <string>
+#include <vector>
 #include <stdexcept>
 
+#if defined(SURFER_ENABLE_TRACE)
+#include <cstdio>
+#endif
+
 // Auto-detect platform if not already defined
 #if !defined(SURFER_PLATFORM_WIN32) && !defined(SURFER_PLATFORM_X11)
 #if defined(_WIN32) || defined(_WIN64)
@@ -20,6 +35,24 @@
 #endif
 #endif
 
+// On Linux, the event loop is built on epoll and gamepads are read directly from evdev
+#if defined(SURFER_PLATFORM_X11) && defined(__linux__)
+#define SURFER_EVENT_LOOP_EPOLL
+#define SURFER_GAMEPAD_EVDEV
+#endif
+
+// Without exceptions (SURFER_NO_EXCEPTIONS, -fno-exceptions) creation failures are only reported through Surfer::Result
+#if !defined(SURFER_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define SURFER_NO_EXCEPTIONS
+#endif
+
+// Define SURFER_SPLIT_IMPLEMENTATION everywhere and SURFER_IMPLEMENTATION in one source file to compile the
+// implementation once, other files then only see the declarations and no native headers
+#if defined(SURFER_SPLIT_IMPLEMENTATION)
+#define SURFER_DEF
+#else
+#define SURFER_DEF inline
+
 // Define Vulkan platform macros before including Vulkan
 #if defined(SURFER_PLATFORM_WIN32)
 #ifndef VK_USE_PLATFORM_WIN32_KHR
@@ -30,25 +63,21 @@
 #define VK_USE_PLATFORM_XLIB_KHR
 #endif
 #endif
+#endif
 
 // Include Vulkan headers
 #include <vulkan/vulkan.h>
 
-
-// Platform-specific includes
+// Native handles are forward declared, only the implementation includes the native headers
 #if defined(SURFER_PLATFORM_WIN32)
-#include <windows.h>
-#include <windowsx.h>
-#include <vulkan/vulkan_win32.h>
-#endif
-
-#if defined(SURFER_PLATFORM_X11)
-#include <X11/Xlib.h>
-#include <X11/Xatom.h>
-#include <X11/XKBlib.h>
-#include <X11/Xutil.h>
-#include <vulkan/vulkan_xlib.h>
-#undef None
+struct HWND__;
+struct HINSTANCE__;
+#elif defined(SURFER_PLATFORM_X11)
+struct _XDisplay;
+struct _XIC;
+union _XEvent;
+struct timespec;
+struct pollfd;
 #endif
 
 namespace Surfer {
@@ -94,1312 +123,6102 @@ namespace Surfer {
         UnsupportedKey
     };
 
-    typedef std::function<void(KeyCode key)> KeyPressCallback;
-    typedef std::function<void(KeyCode key)> KeyReleaseCallback;
-    typedef std::function<void(const char*)> CharacterInputCallback;
-    typedef std::function<void(uint32_t x, uint32_t y)> MouseMotionCallback;
-    typedef std::function<void(uint32_t width, uint32_t height)> ResizeCallback;
-    typedef std::function<void(int32_t x, int32_t y)> MoveCallback;
-    typedef std::function<void()> CloseCallback;
-    typedef std::function<void(bool entered)> MouseEnterExitCallback;
-    typedef std::function<void(bool focused)> FocusCallback;
+    /// Number of KeyCode values including UnsupportedKey
+    const uint32_t KeyCodeCount = static_cast<uint32_t>(KeyCode::UnsupportedKey) + 1u;
 
-#if defined(SURFER_PLATFORM_WIN32)
-    typedef std::function<void(WPARAM wParam)> NativeKeyPressCallback;
-    typedef std::function<void(WPARAM wParam)> NativeKeyReleaseCallback;
-#elif defined(SURFER_PLATFORM_X11)
-    typedef std::function<void(KeySym keySym)> NativeKeyPressCallback;
-    typedef std::function<void(KeySym keySym)> NativeKeyReleaseCallback;
-#endif
+    /**
+     * Modifier keys held during a key press, left and right keys are not distinguished
+     */
+    enum ModifierFlagBits : uint32_t {
+        ModifierShift = 0x1u,
+        ModifierControl = 0x2u,
+        ModifierAlt = 0x4u,
+        ModifierSuper = 0x8u,
+    };
+    typedef uint32_t ModifierFlags;
 
     /**
-     * Represents a single window
+     * Key press with modifiers, one step of a shortcut sequence
      */
-    class Window {
-    public:
-        // We delete all constructors except one that is private
-        Window() = delete; // No default constructor
-        Window(const Window &) = delete; // No copy constructor
-        Window(Window &&) = delete; // No move constructor
-        Window &operator=(const Window &) = delete; // No copy assignment
-        Window &operator=(Window &&) = delete; // No move assignment
+    struct Shortcut {
+        ModifierFlags modifiers;
+        KeyCode key;
+    };
 
-        /**
-         *  Creates and opens a window
-         * @param title Title of the windows that will be displayed in the title bar
-         * @param width Horizontal resolution of the window in pixels
-         * @param height Vertical resolution of the window in pixels
-         * @param x Horizontal position of the windows on the screen
-         * @param y Vertical position of the window on the screen
-         * @return Window pointer
-         */
-        static Window *createWindow(const std::string &title, const uint32_t width,
-                                    const uint32_t height, const int32_t x, const int32_t y) {
-            return new Window(title, width, height, x, y);
-        }
+    /**
+     * Pointer position sample, see Window::getMotionHistory()
+     */
+    struct MotionSample {
+        int32_t x, y; // position in the window
+        uint64_t time; // milliseconds on the platform event clock (X server time, GetMessageTime)
+    };
 
-        /**
-         * Destroy a window
-         * @param window Window pointer
-         */
-        static void destroyWindow(const Window *window) {
-            delete window;
-        }
+    /**
+     * Intrusive waiter resumed by the event loop, storage is owned by the waiting side (e.g. an awaiter inside a
+     * coroutine frame) so waiting never allocates. Used by the coroutine layer in VulkanSurferCoroutines.h.
+     */
+    struct EventWaiter {
+        void (*resume)(EventWaiter *waiter); // called from pollEvents once the event happened
+        void (*cancel)(EventWaiter *waiter); // called instead if the window is destroyed first, can be nullptr
+        void *context; // e.g. the coroutine handle address
+        EventWaiter *next;
 
-        /**
-         * Poll for events
-         */
-        void pollEvents() {
-#if defined(SURFER_PLATFORM_WIN32)
-            Win32_pollEvents();
-#elif defined(SURFER_PLATFORM_X11)
-            X11_pollEvents();
-#endif
-        }
+        // Filled in before resume
+        KeyCode key;
+        uint32_t width, height;
 
-        /**
-         * Checks if window should be closed (e.g. user closed the window)
-         * @return True if window should be closed, else returns false
-         */
-        bool shouldClose() const { return _shouldClose; }
+        std::chrono::steady_clock::time_point deadline; // for timer waiters
+    };
 
+    class Window;
 
-        /**
-         * Function returns cursors position in window relative to top left corner
-         * @param x Horizontal position reference
-         * @param y Vertical position reference
-         */
-        void getCursorPosition(unsigned int &x, unsigned int &y) const {
-            x = _mouse_x;
-            y = _mouse_y;
-        }
+    /// Result of Window::nextKey(), awaitable with VulkanSurferCoroutines.h
+    struct KeyWait {
+        Window *window;
+    };
+
+    /// Result of Window::resized(), awaitable with VulkanSurferCoroutines.h
+    struct ResizeWait {
+        Window *window;
+    };
+
+    /// Result of Window::sleepFor(), awaitable with VulkanSurferCoroutines.h
+    struct SleepWait {
+        Window *window;
+        uint32_t milliseconds;
+    };
+
+    /**
+     * Frame pacing applied by Window::waitFrame, frame rates of 0 mean uncapped
+     */
+    struct PowerPolicy {
+        double focusedFrameRate = 0.0; // frames per second while focused
+        double unfocusedFrameRate = 30.0; // frames per second while visible but not focused
+        bool pauseWhenHidden = true; // while hidden only wake up for events
+    };
+
+    /**
+     * How keyboard keys are translated to KeyCode
+     */
+    enum class KeyTranslationMode {
+        Layout, // by the symbol in the active keyboard layout (KeyCode::KeyQ is the key labeled Q)
+        Scancode, // by physical position on a US QWERTY keyboard (KeyCode::KeyW is the key right of Tab on every layout)
+    };
+
+    /**
+     * How auto-repeat of a held key is reported, text input always repeats
+     */
+    enum class KeyRepeatMode {
+        Press, // repeats are reported as key presses (without releases in between)
+        Separate, // repeats are reported through KeyRepeatCallback only
+        Suppress, // repeats are not reported
+    };
+
+    /**
+     * Snapshot of the window state. Published by the event thread at the end of every poll,
+     * can be read from any thread using Window::getState()
+     */
+    struct WindowState {
+        uint32_t width, height;
+        int32_t x, y;
+        uint32_t mouseX, mouseY;
+        float wheel; // wheel steps scrolled during the last poll, positive away from the user
+        bool focused;
+        bool visible;
+        bool shouldClose;
+        uint64_t keys[(static_cast<uint32_t>(KeyCode::UnsupportedKey) + 64u) / 64u]; // bit per KeyCode
+        uint64_t pressedKeys[sizeof(keys) / sizeof(uint64_t)]; // keys pressed during the last poll, even if released since
 
         /**
-         * @brief Function retrieves window position on screen
-         * @param x Horizontal position
-         * @param y Vertical position
+         * Checks if a key (keyboard or mouse) was held down when the snapshot was taken
+         * @param key Surfer key code
+         * @return True if the key is down
          */
-        void getWindowPosition(unsigned int &x, unsigned int &y) const {
-            x = _x;
-            y = _y;
+        bool isKeyDown(KeyCode key) const {
+            const uint32_t index = static_cast<uint32_t>(key);
+            return (keys[index / 64u] >> (index % 64u)) & 1u;
         }
 
         /**
-         * @brief Function retrieves window size (resolution)
-         * @param width Horizontal resolution in pixels
-         * @param height Vertical resolution in pixels
+         * Checks if a key (keyboard or mouse) was pressed during the last poll, catches presses released within the poll
+         * @param key Surfer key code
+         * @return True if the key was pressed
          */
-        void getWindowSize(unsigned int &width, unsigned int &height) const {
-            width = _width;
-            height = _height;
+        bool wasKeyPressed(KeyCode key) const {
+            const uint32_t index = static_cast<uint32_t>(key);
+            return (pressedKeys[index / 64u] >> (index % 64u)) & 1u;
         }
+    };
 
-#if defined(SURFER_PLATFORM_WIN32)
-        HWND getNativeWindowPtr() const { return Win32_hWnd; }
-#elif defined(SURFER_PLATFORM_X11)
-        ::Window getNativeWindowPtr() const { return X11_window; }
-#endif
-
-        /**
-         * Registers a callback that is triggered when a key is pressed. This can be a keyboard key or mouse key or any other.
-         * @param callback KeyPressCallback function
-         */
-        void registerKeyPressCallback(const KeyPressCallback &callback) { this->_keyPressCallback = callback; }
+#if defined(SURFER_ENABLE_METRICS)
+    /**
+     * Event categories counted by the event loop metrics
+     */
+    enum class EventType {
+        Key, MouseButton, MouseMotion, MouseCrossing, Focus, Configure, Redraw, WindowManager, Selection,
 
-        /**
-         * Registers a callback that is triggered when a key is released. This can be a keyboard key or mouse key or any other.
-         * @param callback KeyReleaseCallback function
-         */
-        void registerKeyReleaseCallback(const KeyReleaseCallback &callback) { this->_keyReleaseCallback = callback; }
+        // Everything else
+        Other
+    };
 
-        /**
-         * Registers a callback that is triggered when character input is provided from an OS
-         * @param callback  CharacterInputCallback function (receives utf8 value)
-         * @note This is different from KeyPressCallback which handles key inputs (shortcuts, enter etc.)
-         */
-        void registerCharacterInputCallback(const CharacterInputCallback &callback) {this->_characterInputCallback = callback; }
+    /// Number of EventType values
+    const uint32_t EventTypeCount = static_cast<uint32_t>(EventType::Other) + 1u;
 
-        /**
-         * Registers a callback that is triggered when a mouse is moved (cursor position has changed)
-         * @param callback MouseMotionCallback function
-         */
-        void registerMouseMotionCallback(const MouseMotionCallback &callback) { this->_mouseMotionCallback = callback; }
+    /// Number of histogram buckets, bucket 0 counts durations under 1 us, bucket i in [2^(i-1), 2^i) us, the last one the rest
+    const uint32_t HistogramBucketCount = 24u;
 
-        /**
-         * Registers a callback that is triggered when the window is resized
-         * @param callback ResizeCallback function
-         */
-        void registerResizeCallback(const ResizeCallback &callback) { this->_resizeCallback = callback; }
+    /**
+     * Event loop metrics, see Window::getStats()
+     */
+    struct Stats {
+        uint64_t polls; // number of pollEvents/waitEvents calls
+        uint64_t events[EventTypeCount]; // dispatched events per EventType
+        uint64_t pollDuration[HistogramBucketCount]; // time spent processing events per poll, excluding the wait
+        uint64_t eventDuration[HistogramBucketCount]; // time per event, including the user callbacks it triggered
+        uint32_t maxQueueDepth; // most events pending at the start of a poll
+
+        uint64_t getEventCount(EventType type) const { return events[static_cast<uint32_t>(type)]; }
+    };
+#endif
 
-        /**
-         * Registers a callback that is triggered when the window is moved on the screen.
-         * @param callback MoveCallback function
-         */
-        void registerMoveCallback(const MoveCallback &callback) { this->_moveCallback = callback; }
+#if defined(SURFER_ENABLE_TRACE)
+#ifndef SURFER_TRACE_CAPACITY
+#define SURFER_TRACE_CAPACITY 65536 // zones recorded per thread, later zones are dropped
+#endif
 
+    /**
+     * Trace zones recorded into per-thread buffers, written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+     * Timestamps come from std::chrono::steady_clock so they line up with other traces using the same clock.
+     */
+    class Trace {
+    public:
         /**
-         * Registers a callback that is triggered when the window is closed.
-         * @param callback CloseCallback function
+         * Records a finished zone on the calling thread, lock-free. Memory is taken in small chunks as zones are
+         * recorded, if it runs out zones are dropped.
+         * @param name Zone name, must outlive the trace (string literal), escaped when written
+         * @param begin Start time from now()
+         * @param end End time from now()
          */
-        void registerCloseCallback(const CloseCallback &callback) { this->_closeCallback = callback; }
+        static void record(const char *name, int64_t begin, int64_t end) {
+            Buffer *buffer = threadBuffer();
+            if (buffer == nullptr) {
+                return;
+            }
+            const uint32_t count = buffer->count.load(std::memory_order_relaxed);
+            if (count >= SURFER_TRACE_CAPACITY) {
+                return;
+            }
+            Chunk *chunk = buffer->chunks[count / ChunkZoneCount].load(std::memory_order_relaxed);
+            if (chunk == nullptr) {
+                chunk = new(std::nothrow) Chunk();
+                if (chunk == nullptr) {
+                    return; // out of memory, the zone is dropped
+                }
+                buffer->chunks[count / ChunkZoneCount].store(chunk, std::memory_order_relaxed);
+            }
+            Zone &zone = chunk->zones[count % ChunkZoneCount];
+            zone.name = name;
+            zone.begin = begin;
+            zone.end = end;
+            buffer->count.store(count + 1u, std::memory_order_release); // publish to writeChromeTrace
+        }
 
         /**
-         * Registers a callback that is triggered when a mouse enter (true) or exits (false) the window
-         * @param callback MouseEnterExitCallback function
+         * @return Current time in nanoseconds
          */
-        void registerMouseEnterExitCallback(const MouseEnterExitCallback &callback) {
-            this->_mouseEnterExitCallback = callback;
+        static int64_t now() {
+            return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
         }
 
         /**
-         * Registers a callback that is triggered when the window becomes in focus (true) or loses focus (false)
-         * @param callback FocusCallback function
+         * Writes zones recorded so far by all threads as Chrome trace JSON. Can be called from any thread while others keep recording.
+         * @param path Output file path
+         * @return True on success
          */
-        void registerFocusCallback(const FocusCallback &callback) { this->_focusCallback = callback; }
+        static bool writeChromeTrace(const std::string &path) {
+            FILE *file = std::fopen(path.c_str(), "w");
+            if (file == nullptr) {
+                return false;
+            }
 
-        /**
-         * Registers a callback that is triggered when any key is press and native KeySym is passed to the callback
-         * This can be used if a needed key mapping is not supported by Surfer (un-complete mapping or unsupported key)
-         * @param callback NativeKeyPressCallback function
-         */
-        void registerNativeKeyPressCallback(const NativeKeyPressCallback &callback) {
-            this->_nativeKeyPressCallback = callback;
+            std::fputs("{\"traceEvents\":[", file);
+            bool first = true;
+            for (const Buffer *buffer = head().load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+                const uint32_t count = buffer->count.load(std::memory_order_acquire);
+                for (uint32_t i = 0; i < count; i++) {
+                    const Zone &zone = buffer->chunks[i / ChunkZoneCount].load(std::memory_order_relaxed)->zones[i % ChunkZoneCount];
+                    std::fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+                    writeJsonString(file, zone.name);
+                    std::fprintf(file, "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                                 static_cast<double>(zone.begin) / 1000.0,
+                                 static_cast<double>(zone.end - zone.begin) / 1000.0, buffer->threadId);
+                    first = false;
+                }
+            }
+            std::fputs("\n]}\n", file);
+            return std::fclose(file) == 0;
         }
 
         /**
-         * Registers a callback that is triggered when any key is released and native KeySym is passed to the callback
-         * This can be used if a needed key mapping is not supported by Surfer (un-complete mapping or unsupported key)
-         * @param callback NativeKeyReleaseCallback function
+         * Frees the buffers of all threads, zones recorded so far are dropped. No thread may record or write the
+         * trace at the same time. Threads recording afterwards start with a new buffer.
          */
-        void registerNativeKeyReleaseCallback(const NativeKeyReleaseCallback &callback) {
-            this->_nativeKeyReleaseCallback = callback;
-        }
-
-        VkResult createSurface(VkInstance instance, VkSurfaceKHR *surface) {
-#if defined(SURFER_PLATFORM_WIN32)
-            return Win32_CreateSurface(instance, surface);
-#elif defined(SURFER_PLATFORM_X11)
-            return X11_CreateSurface(instance, surface);
-#endif
+        static void shutdown() {
+            Buffer *buffer = head().exchange(nullptr, std::memory_order_acquire);
+            generation().fetch_add(1u, std::memory_order_relaxed);
+            while (buffer != nullptr) {
+                Buffer *next = buffer->next;
+                for (std::atomic<Chunk *> &chunk: buffer->chunks) {
+                    delete chunk.load(std::memory_order_relaxed);
+                }
+                delete buffer;
+                buffer = next;
+            }
         }
 
-    protected:
-        Window(const std::string &title, const uint32_t width, const uint32_t height,
-               const int32_t x, const int32_t y) {
-            if (width == 0 || height == 0) {
-                throw std::runtime_error("VulkanSurfer: width == 0 || height == 0");;
+    private:
+        struct Zone {
+            const char *name;
+            int64_t begin, end;
+        };
+
+        static const uint32_t ChunkZoneCount = 1024u;
+
+        struct Chunk {
+            Zone zones[ChunkZoneCount];
+        };
+
+        // Buffers outlive their threads until shutdown, so zones of finished threads can still be written
+        struct Buffer {
+            std::atomic<Chunk *> chunks[(SURFER_TRACE_CAPACITY + ChunkZoneCount - 1u) / ChunkZoneCount] = {};
+            std::atomic<uint32_t> count{0u};
+            uint32_t threadId = 0u;
+            Buffer *next = nullptr;
+        };
+
+        static void writeJsonString(FILE *file, const char *text) {
+            for (; *text != '\0'; text++) {
+                const unsigned char c = static_cast<unsigned char>(*text);
+                if (c == '"' || c == '\\') {
+                    std::fputc('\\', file);
+                    std::fputc(c, file);
+                } else if (c < 0x20u) {
+                    std::fprintf(file, "\\u%04x", c);
+                } else {
+                    std::fputc(c, file);
+                }
             }
-#if defined(SURFER_PLATFORM_WIN32)
-            Win32_createWindow(title, width, height, x, y);
-#elif defined(SURFER_PLATFORM_X11)
-            X11_createWindow(title, width, height, x, y);
-#endif
         }
 
-        ~Window() {
-#if defined(SURFER_PLATFORM_WIN32)
-            Win32_destroyWindow();
-#elif defined(SURFER_PLATFORM_X11)
-            X11_destroyWindow();
-#endif
+        static std::atomic<Buffer *> &head() {
+            static std::atomic<Buffer *> head{nullptr};
+            return head;
         }
 
+        // Incremented by shutdown, a thread whose buffer is from an older generation takes a new one
+        static std::atomic<uint32_t> &generation() {
+            static std::atomic<uint32_t> generation{0u};
+            return generation;
+        }
 
-        // State
-        bool _shouldClose = false;
-        uint32_t _width = 0u, _height = 0u;
-        int32_t _x = 0, _y = 0;
-        uint32_t _mouse_x = 0u, _mouse_y = 0u;
-        bool _focused = false, _mouseEntered = false;
-        std::string _title{};
+        // Returns nullptr if the buffer can not be allocated, it is tried again on the next zone
+        static Buffer *threadBuffer() {
+            thread_local Buffer *buffer = nullptr;
+            thread_local uint32_t bufferGeneration = 0u;
+            const uint32_t currentGeneration = generation().load(std::memory_order_relaxed);
+            if (buffer == nullptr || bufferGeneration != currentGeneration) {
+                static std::atomic<uint32_t> threadIds{0u};
+                buffer = new(std::nothrow) Buffer();
+                if (buffer == nullptr) {
+                    return nullptr;
+                }
+                bufferGeneration = currentGeneration;
+                buffer->threadId = threadIds.fetch_add(1u, std::memory_order_relaxed) + 1u;
 
-        // Callbacks
-        KeyPressCallback _keyPressCallback = nullptr;
-        CharacterInputCallback _characterInputCallback = nullptr;
-        KeyReleaseCallback _keyReleaseCallback = nullptr;
-        MouseMotionCallback _mouseMotionCallback = nullptr;
-        ResizeCallback _resizeCallback = nullptr;
-        MoveCallback _moveCallback = nullptr;
-        CloseCallback _closeCallback = nullptr;
-        MouseEnterExitCallback _mouseEnterExitCallback = nullptr;
-        FocusCallback _focusCallback = nullptr;
-        NativeKeyPressCallback _nativeKeyPressCallback = nullptr;
-        NativeKeyReleaseCallback _nativeKeyReleaseCallback = nullptr;
+                buffer->next = head().load(std::memory_order_relaxed);
+                while (!head().compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                }
+            }
+            return buffer;
+        }
+    };
 
+    /**
+     * Records a zone from construction to destruction, use SURFER_TRACE_ZONE
+     */
+    class TraceZone {
+    public:
+        explicit TraceZone(const char *name) : _name(name), _begin(Trace::now()) {}
+        ~TraceZone() { Trace::record(_name, _begin, Trace::now()); }
 
-#if defined(SURFER_PLATFORM_WIN32)
-        HWND Win32_hWnd;
-        HINSTANCE Win32_hInstance;
-        MSG Win32_msg{};
-        bool Win32_resizing = false;
+        TraceZone(const TraceZone &) = delete;
+        TraceZone &operator=(const TraceZone &) = delete;
 
+    private:
+        const char *_name;
+        int64_t _begin;
+    };
 
-        void Win32_createWindow(const std::string &title, const uint32_t width,
-                                const uint32_t height, const int32_t x, const int32_t y) {
-            _width = width;
-            _height = height;
-            _x = x;
-            _y = y;
-            _title = title;
+#define SURFER_TRACE_CONCAT_IMPL(a, b) a##b
+#define SURFER_TRACE_CONCAT(a, b) SURFER_TRACE_CONCAT_IMPL(a, b)
+#define SURFER_TRACE_ZONE(name) Surfer::TraceZone SURFER_TRACE_CONCAT(surferTraceZone, __LINE__)(name)
+#else
+#define SURFER_TRACE_ZONE(name) ((void)0)
+#endif
 
-            SetProcessDPIAware();
+    enum class GamepadButton {
+        // Face buttons (Xbox layout labels)
+        A, B, X, Y,
 
-            Win32_hInstance = GetModuleHandle(nullptr);
+        // Shoulders and center
+        LeftBumper, RightBumper, Back, Start, Guide,
 
-            WNDCLASSEX wc = {};
-            wc.cbSize = sizeof(WNDCLASSEX);
-            wc.style = CS_HREDRAW | CS_VREDRAW;
-            wc.lpfnWndProc = this->WndProc;
-            wc.hInstance = Win32_hInstance;
-            wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
-            wc.lpszClassName = title.c_str();
+        // Stick clicks
+        LeftThumb, RightThumb,
 
-            if (!RegisterClassEx(&wc)) {
-                throw std::runtime_error("VulkanSurfer: Failed to register window class");
-            }
+        // D-pad
+        DpadUp, DpadDown, DpadLeft, DpadRight,
 
-            // Calculate window rect to account for borders and title bar
-            RECT windowRect = {0, 0, static_cast<LONG>(width), static_cast<LONG>(height)};
-            AdjustWindowRectEx(&windowRect, WS_OVERLAPPEDWINDOW, FALSE, 0);
-            int adjustedWidth = windowRect.right - windowRect.left;
-            int adjustedHeight = windowRect.bottom - windowRect.top;
+        // Unspecified/Future Extensions
+        UnsupportedButton
+    };
 
-            Win32_hWnd = CreateWindowEx(
-                0,
-                wc.lpszClassName,
-                title.c_str(),
-                WS_OVERLAPPEDWINDOW,
-                x, y,
-                adjustedWidth, adjustedHeight, // Use adjusted dimensions
-                nullptr,
-                nullptr,
-                wc.hInstance,
-                this);
+    enum class GamepadAxis {
+        // Sticks
+        LeftX, LeftY, RightX, RightY,
 
-            if (!Win32_hWnd) {
-                throw std::runtime_error("VulkanSurfer: Failed to create window");
-            }
+        // Triggers
+        LeftTrigger, RightTrigger,
 
-            SetWindowLongPtr(Win32_hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
-            ShowWindow(Win32_hWnd, SW_SHOW);
-            UpdateWindow(Win32_hWnd);
-        }
+        // Unspecified/Future Extensions
+        UnsupportedAxis
+    };
 
-        void Win32_destroyWindow() {
-            MSG msg;
-            while (PeekMessage(&msg, Win32_hWnd, 0, 0, PM_REMOVE)) {
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
-            }
+    /// Maximum number of gamepads tracked at once
+    const uint32_t MaxGamepads = 4u;
 
-            if (Win32_hWnd) {
-                // Don't destroy if already being destroyed
-                if (IsWindow(Win32_hWnd)) {
-                    // This triggers WM_DESTROY
-                    DestroyWindow(Win32_hWnd);
-                }
-                Win32_hWnd = nullptr;
-            }
+    /// Number of GamepadAxis values excluding UnsupportedAxis
+    const uint32_t GamepadAxisCount = static_cast<uint32_t>(GamepadAxis::UnsupportedAxis);
 
-            // Only unregister if we're the last window using this class
-            WNDCLASSEX wc = {};
-            wc.cbSize = sizeof(WNDCLASSEX);
-            if (GetClassInfoEx(GetModuleHandle(nullptr), _title.c_str(), &wc)) {
-                UnregisterClass(_title.c_str(), GetModuleHandle(nullptr));
-            }
-        }
+    /**
+     * State of a single gamepad
+     */
+    struct GamepadState {
+        bool connected;
+        uint32_t buttons; // bit per GamepadButton
+        float axes[GamepadAxisCount]; // sticks in <-1, 1> (positive y is down), triggers in <0, 1>
 
-        VkResult Win32_CreateSurface(VkInstance instance, VkSurfaceKHR *surface) const {
-            VkWin32SurfaceCreateInfoKHR surfaceCreateInfo = {};
-            surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-            surfaceCreateInfo.hwnd = Win32_hWnd;
-            surfaceCreateInfo.hinstance = Win32_hInstance;
+        bool isButtonDown(GamepadButton button) const { return (buttons >> static_cast<uint32_t>(button)) & 1u; }
+        float getAxis(GamepadAxis axis) const { return axes[static_cast<uint32_t>(axis)]; }
+    };
 
-            return vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, surface);
-        }
+    /**
+     * X11 selection (clipboard) kinds
+     */
+    enum class Selection {
+        Clipboard, // CLIPBOARD, explicit copy / paste
+        Primary // PRIMARY, currently selected text, pasted with middle click
+    };
 
-        void Win32_pollEvents() {
-            while (PeekMessage(&Win32_msg, nullptr, 0, 0, PM_REMOVE)) {
-                TranslateMessage(&Win32_msg);
-                DispatchMessage(&Win32_msg);
-            }
-        }
+    /**
+     * CPU accessible framebuffer for software rendering
+     */
+    struct Framebuffer {
+        void *pixels; // 32 bit pixels in the byte order of the window visual (BGRX on little endian machines)
+        uint32_t width, height;
+        uint32_t stride; // bytes per row
+    };
 
-        /// internal window procedure function for Win32 API
-        static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
-            Window *window = reinterpret_cast<Window *>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    /**
+     * Result of Window::tryCreateWindow
+     */
+    enum class Result {
+        Ok, // not Success, Xlib defines it as a macro
+        InvalidSize, // width or height is 0
+        OutOfMemory,
+        DisplayUnavailable, // X11: XOpenDisplay failed
+        ClassRegistrationFailed, // Win32: RegisterClassEx failed
+        WindowCreationFailed,
+    };
+
+    /**
+     * Describes a result
+     * @param result Result
+     * @return Null-terminated description
+     */
+    inline const char *getResultString(Result result) {
+        switch (result) {
+            case Result::Ok: return "Ok";
+            case Result::InvalidSize: return "width == 0 || height == 0";
+            case Result::OutOfMemory: return "Out of memory";
+            case Result::DisplayUnavailable: return "Failed to open X display";
+            case Result::ClassRegistrationFailed: return "Failed to register window class";
+            case Result::WindowCreationFailed: return "Failed to create window";
+        }
+        return "Unknown result";
+    }
+
+    /**
+     * Present latency preference of a Swapchain, falls back to VSync if the preferred mode is not supported
+     */
+    enum class PresentLatency {
+        VSync, // FIFO, no tearing, up to a few frames of latency
+        LowLatency, // MAILBOX, no tearing, the newest frame replaces a queued one
+        Uncapped, // IMMEDIATE (or MAILBOX), may tear
+    };
+
+    /**
+     * Swapchain creation settings
+     */
+    struct SwapchainSettings {
+        PresentLatency latency = PresentLatency::VSync;
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        bool srgb = true; // prefer an sRGB format over UNORM
+    };
+
+    /**
+     * Non-owning view of a contiguous range of elements
+     */
+    template<typename T>
+    struct Span {
+        const T *data;
+        size_t size;
+
+        Span() : data(nullptr), size(0u) {}
+        Span(const T *data, size_t size) : data(data), size(size) {}
+
+        const T *begin() const { return data; }
+        const T *end() const { return data + size; }
+        bool empty() const { return size == 0u; }
+        const T &operator[](size_t index) const { return data[index]; }
+    };
+
+    /**
+     * Allocates memory through user callbacks, or operator new when there are none
+     * @param callbacks Allocation callbacks, can be nullptr
+     * @param size Size in bytes
+     * @param alignment Alignment in bytes
+     * @return Memory or nullptr if the allocation failed
+     */
+    inline void *allocateMemory(const VkAllocationCallbacks *callbacks, size_t size, size_t alignment) {
+        if (callbacks != nullptr) {
+            return callbacks->pfnAllocation(callbacks->pUserData, size, alignment, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+        }
+        return ::operator new(size, std::nothrow);
+    }
+
+    /**
+     * Frees memory returned by allocateMemory
+     * @param callbacks Allocation callbacks the memory was allocated with
+     * @param memory Memory, can be nullptr
+     */
+    inline void freeMemory(const VkAllocationCallbacks *callbacks, void *memory) {
+        if (callbacks != nullptr) {
+            callbacks->pfnFree(callbacks->pUserData, memory);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    /**
+     * Standard allocator over allocateMemory, lets the internal containers use the window allocation callbacks
+     */
+    template<typename T>
+    class Allocator {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        Allocator(const VkAllocationCallbacks *callbacks = nullptr) : _callbacks(callbacks) {}
+
+        template<typename U>
+        Allocator(const Allocator<U> &other) : _callbacks(other.callbacks()) {}
+
+        T *allocate(size_t count) {
+            void *memory = allocateMemory(_callbacks, count * sizeof(T), alignof(T));
+            if (memory == nullptr) {
+#if defined(SURFER_NO_EXCEPTIONS)
+                std::abort(); // what the standard containers do without exceptions
+#else
+                throw std::bad_alloc();
+#endif
+            }
+            return static_cast<T *>(memory);
+        }
+
+        void deallocate(T *memory, size_t) { freeMemory(_callbacks, memory); }
+
+        const VkAllocationCallbacks *callbacks() const { return _callbacks; }
+
+    private:
+        const VkAllocationCallbacks *_callbacks;
+    };
+
+    template<typename T, typename U>
+    bool operator==(const Allocator<T> &a, const Allocator<U> &b) { return a.callbacks() == b.callbacks(); }
+
+    template<typename T, typename U>
+    bool operator!=(const Allocator<T> &a, const Allocator<U> &b) { return a.callbacks() != b.callbacks(); }
+
+    template<typename T>
+    using Vector = std::vector<T, Allocator<T>>;
+    typedef std::basic_string<char, std::char_traits<char>, Allocator<char>> String;
+
+    typedef std::function<void(KeyCode key)> KeyPressCallback;
+    typedef std::function<void(KeyCode key)> KeyReleaseCallback;
+    typedef std::function<void(KeyCode key)> KeyRepeatCallback;
+    typedef std::function<void(const char*)> CharacterInputCallback;
+    typedef std::function<void(uint32_t x, uint32_t y)> MouseMotionCallback;
+    typedef std::function<void(uint32_t width, uint32_t height)> ResizeCallback;
+    typedef std::function<void(int32_t x, int32_t y)> MoveCallback;
+    typedef std::function<void()> CloseCallback;
+    typedef std::function<void(bool entered)> MouseEnterExitCallback;
+    typedef std::function<void(bool focused)> FocusCallback;
+    typedef std::function<void(bool visible)> OcclusionCallback;
+    typedef std::function<void(uint32_t index, bool connected)> GamepadConnectionCallback;
+    typedef std::function<void(bool success, Span<char> data)> ClipboardCallback;
+    typedef std::function<void(Span<const char *> paths, bool finished)> FileDropCallback;
+    typedef std::function<void(int fd, uint32_t events)> FileDescriptorCallback;
+    typedef std::function<void()> TimerCallback;
+
+    class Swapchain;
+    typedef std::function<void(const Swapchain &swapchain)> SwapchainRecreateCallback;
+
+    typedef std::function<void(uint32_t action)> ShortcutCallback;
+
+    /**
+     * Matches key presses against shortcut sequences (Ctrl+S, or chords like Ctrl+K, Ctrl+S) bound to action ids.
+     * Bindings are compiled into a trie whose transitions live in one open addressing hash keyed by
+     * (state, modifiers, key), so a key press costs one lookup however many bindings there are. Attach it to a window
+     * with Window::setShortcutMap, chord timeouts are then driven by the event loop.
+     */
+    class ShortcutMap {
+    public:
+        static const uint32_t NoAction = UINT32_MAX;
+
+        explicit ShortcutMap(const VkAllocationCallbacks *allocator = nullptr);
+
+        /**
+         * Binds a sequence of key presses to an action, replaces the action of an already bound sequence.
+         * A sequence that is also the prefix of a longer one fires when the chord times out or is broken.
+         * @param action Action id passed to the callback
+         * @param sequence Key presses, modifier keys themselves can not be part of it
+         * @return False if the sequence is empty or contains a modifier or unsupported key
+         */
+        bool bind(uint32_t action, Span<Shortcut> sequence);
+
+        /**
+         * Binds a single key press to an action
+         * @param action Action id passed to the callback
+         * @param modifiers Modifiers that have to be held, exactly
+         * @param key Key (keyboard or mouse)
+         * @return False if the key is a modifier or unsupported key
+         */
+        bool bind(uint32_t action, ModifierFlags modifiers, KeyCode key) {
+            const Shortcut shortcut = {modifiers, key};
+            return bind(action, Span<Shortcut>(&shortcut, 1u));
+        }
+
+        /**
+         * Removes all bindings
+         */
+        void clear();
+
+        /**
+         * Sets how long the next key of a chord is waited for, 1000 ms by default
+         * @param milliseconds Timeout
+         */
+        void setChordTimeout(uint32_t milliseconds) { _chordTimeout = std::chrono::milliseconds(milliseconds); }
+
+        /**
+         * Registers callback that is called once per matched action
+         * @param callback ShortcutCallback function
+         */
+        void registerActionCallback(const ShortcutCallback &callback) { _actionCallback = callback; }
+
+        /**
+         * Checks if the first keys of a chord were pressed and the rest is awaited
+         * @return True if a chord is pending
+         */
+        bool isChordPending() const { return _state != 0u; }
+
+        /**
+         * Advances the matcher by a key press, called by the window
+         * @param modifiers Modifiers held during the press
+         * @param key Pressed key
+         * @return True if the key was part of a shortcut
+         */
+        bool onKeyPress(ModifierFlags modifiers, KeyCode key);
+
+        /**
+         * Ends a chord whose timeout passed, called by the window after every poll
+         */
+        void update();
+
+        // Shortens a wait timeout in milliseconds (-1 infinite) to the pending chord timeout
+        int clampTimeout(int timeout) const;
+
+    protected:
+        // Trie node, state 0 is the root
+        struct State {
+            uint32_t action;
+            bool hasTransitions;
+        };
+
+        struct Transition {
+            uint64_t key; // EmptyKey marks a free slot
+            uint32_t target;
+        };
+
+        static const uint64_t EmptyKey = UINT64_MAX;
+
+        Vector<State> _states;
+        Vector<Transition> _transitions; // power of two size, at most half full
+        size_t _transitionCount = 0u;
+        uint32_t _state = 0u;
+        std::chrono::steady_clock::time_point _deadline{};
+        std::chrono::milliseconds _chordTimeout{1000};
+        ShortcutCallback _actionCallback = nullptr;
+
+        static bool isModifierKey(KeyCode key);
+
+        static uint64_t transitionKey(uint32_t state, ModifierFlags modifiers, KeyCode key);
+
+        // Returns the target state, 0 if there is no transition
+        uint32_t findTransition(uint64_t key) const;
+
+        void insertTransition(uint64_t key, uint32_t target);
+
+        // Leaves a pending chord and fires the action bound to the keys pressed so far
+        void finishChord();
+
+        void fire(uint32_t action);
+    };
+
+    /**
+     * Maps input to gameplay actions with values. Bindings are compiled into terms: keys and mouse buttons with the
+     * same scale into one mask over the WindowState key bits, gamepad buttons into masks over GamepadState::buttons.
+     * update() evaluates every action in one pass without lookups, the results are packed into a value array and
+     * down/pressed/released bitsets.
+     */
+    class ActionMap {
+    public:
+        /**
+         * @param actionCount Number of actions, ids are 0 to actionCount - 1
+         * @param allocator Allocation callbacks, can be nullptr
+         */
+        explicit ActionMap(uint32_t actionCount, const VkAllocationCallbacks *allocator = nullptr);
+
+        /**
+         * Adds scale to the action value while a key or mouse button is held (e.g. W +1, S -1 for a move axis).
+         * Keys of an action with the same scale are combined, holding both adds the scale once.
+         * A key pressed and released within one poll counts as held for that update.
+         * @param action Action id
+         * @param key Key (keyboard or mouse)
+         * @param scale Value added while held
+         * @return False if the action id or key is out of range, or for the wheel keys which are never held (use bindWheel)
+         */
+        bool bindKey(uint32_t action, KeyCode key, float scale = 1.0f);
+
+        /**
+         * Adds scale to the action value while a gamepad button is held
+         * @param action Action id
+         * @param gamepad Gamepad index
+         * @param button Gamepad button
+         * @param scale Value added while held
+         * @return False if the action id, gamepad or button is out of range
+         */
+        bool bindGamepadButton(uint32_t action, uint32_t gamepad, GamepadButton button, float scale = 1.0f);
+
+        /**
+         * Adds a gamepad axis multiplied by scale to the action value, after the window gamepad deadzone
+         * @param action Action id
+         * @param gamepad Gamepad index
+         * @param axis Gamepad axis
+         * @param scale Axis multiplier, -1 inverts
+         * @return False if the action id, gamepad or axis is out of range
+         */
+        bool bindGamepadAxis(uint32_t action, uint32_t gamepad, GamepadAxis axis, float scale = 1.0f);
+
+        /**
+         * Adds the wheel steps of the last poll multiplied by scale to the action value
+         * @param action Action id
+         * @param scale Wheel multiplier
+         * @return False if the action id is out of range
+         */
+        bool bindWheel(uint32_t action, float scale = 1.0f);
+
+        /**
+         * Removes all bindings, action states are kept until the next update
+         */
+        void clear();
+
+        /**
+         * Evaluates all actions, call once per frame after pollEvents
+         * @param window Window whose input is read
+         */
+        void update(const Window &window);
+
+        /**
+         * Evaluates all actions from a state snapshot, usable from any thread with Window::getState()
+         * @param state Window state
+         * @param gamepads States of gamepads 0 to MaxGamepads - 1, can be empty if no gamepad is bound
+         */
+        void update(const WindowState &state, Span<GamepadState> gamepads);
+
+        float getValue(uint32_t action) const { return _values[action]; }
+        bool isDown(uint32_t action) const { return testBit(_down, action); }
+        bool wasPressed(uint32_t action) const { return testBit(_pressed, action); }
+        bool wasReleased(uint32_t action) const { return testBit(_released, action); }
+
+        /**
+         * Returns the values of all actions, an action is down while its value is not 0
+         * @return Span indexed by action id, valid until the bindings change
+         */
+        Span<float> getValues() const { return Span<float>(_values.data(), _values.size()); }
+
+    protected:
+        static const uint32_t KeyWordCount = sizeof(WindowState::keys) / sizeof(uint64_t);
+
+        struct KeyTerm {
+            uint64_t mask[KeyWordCount];
+            uint32_t action;
+            float scale;
+        };
+
+        struct ButtonTerm {
+            uint32_t mask; // bit per GamepadButton
+            uint32_t gamepad;
+            uint32_t action;
+            float scale;
+        };
+
+        // Source of an analog term, gamepad axes use their GamepadAxis index
+        static const uint32_t WheelSource = UINT32_MAX;
+
+        struct AxisTerm {
+            uint32_t source;
+            uint32_t gamepad;
+            uint32_t action;
+            float scale;
+        };
+
+        uint32_t _actionCount;
+        Vector<KeyTerm> _keyTerms;
+        Vector<ButtonTerm> _buttonTerms;
+        Vector<AxisTerm> _axisTerms;
+        bool _usesGamepads = false;
+
+        Vector<float> _values;
+        Vector<uint64_t> _down, _pressed, _released; // bit per action
+
+        static bool testBit(const Vector<uint64_t> &bits, uint32_t index) {
+            return ((bits[index / 64u] >> (index % 64u)) & 1u) != 0u;
+        }
+    };
+
+#if defined(SURFER_PLATFORM_WIN32)
+    // Win32 types as windows.h declares them (STRICT handles)
+    namespace Win32 {
+        typedef ::HWND__ *HWND;
+        typedef ::HINSTANCE__ *HINSTANCE;
+        typedef unsigned int UINT;
+        typedef unsigned long DWORD;
+#if defined(_WIN64)
+        typedef unsigned __int64 WPARAM;
+        typedef __int64 LPARAM;
+#else
+        typedef unsigned int WPARAM;
+        typedef long LPARAM;
+#endif
+        typedef LPARAM LRESULT;
+    }
+
+    typedef std::function<void(Win32::WPARAM wParam)> NativeKeyPressCallback;
+    typedef std::function<void(Win32::WPARAM wParam)> NativeKeyReleaseCallback;
+#elif defined(SURFER_PLATFORM_X11)
+    // Xlib types as Xlib declares them
+    namespace X11 {
+        typedef ::_XDisplay Display;
+        typedef ::_XEvent XEvent;
+        typedef ::_XIC *XIC;
+        typedef unsigned long XID;
+        typedef XID Window;
+        typedef XID Atom;
+        typedef XID KeySym;
+        typedef unsigned long Time;
+        typedef char *XPointer;
+    }
+
+    typedef std::function<void(X11::KeySym keySym)> NativeKeyPressCallback;
+    typedef std::function<void(X11::KeySym keySym)> NativeKeyReleaseCallback;
+#endif
+
+    /**
+     * Represents a single window
+     */
+    class Window {
+    public:
+        // We delete all constructors except one that is private
+        Window() = delete; // No default constructor
+        Window(const Window &) = delete; // No copy constructor
+        Window(Window &&) = delete; // No move constructor
+        Window &operator=(const Window &) = delete; // No copy assignment
+        Window &operator=(Window &&) = delete; // No move assignment
+
+        /**
+         *  Creates and opens a window
+         * @param title Title of the windows that will be displayed in the title bar
+         * @param width Horizontal resolution of the window in pixels
+         * @param height Vertical resolution of the window in pixels
+         * @param x Horizontal position of the windows on the screen
+         * @param y Vertical position of the window on the screen
+         * @param allocator Callbacks for the window memory and its surfaces, copied, nullptr uses operator new
+         * @return Window pointer, throws std::runtime_error on failure (returns nullptr with SURFER_NO_EXCEPTIONS)
+         */
+        static Window *createWindow(const std::string &title, const uint32_t width,
+                                    const uint32_t height, const int32_t x, const int32_t y,
+                                    const VkAllocationCallbacks *allocator = nullptr);
+
+        /**
+         * Creates and opens a window without throwing
+         * @param title Title of the windows that will be displayed in the title bar
+         * @param width Horizontal resolution of the window in pixels
+         * @param height Vertical resolution of the window in pixels
+         * @param x Horizontal position of the windows on the screen
+         * @param y Vertical position of the window on the screen
+         * @param out Receives the window pointer, nullptr on failure
+         * @param allocator Callbacks for the window memory and its surfaces, copied, nullptr uses operator new
+         * @return Result::Ok or the reason the window could not be created
+         */
+        static Result tryCreateWindow(const std::string &title, const uint32_t width,
+                                      const uint32_t height, const int32_t x, const int32_t y, Window **out,
+                                      const VkAllocationCallbacks *allocator = nullptr);
+
+        /**
+         * Destroy a window
+         * @param window Window pointer
+         */
+        static void destroyWindow(const Window *window);
+
+        /**
+         * Poll for events
+         */
+        void pollEvents();
+
+        /**
+         * Processes pending events up to a budget, the rest stays queued for the next call. Close requests and
+         * resizes (X11), or clicks on the window frame and posted system commands such as close (Win32), are taken
+         * out of the queue first, so they are not delayed by an event storm.
+         * @param maxEvents Maximum number of events to process
+         * @param maxMicros Maximum time to spend processing events in microseconds, checked between events
+         * @return True if events are still pending
+         */
+        bool pollEvents(uint32_t maxEvents, uint32_t maxMicros);
+
+        /**
+         * Waits until at least one event is available and then processes all pending events
+         * @note Use this instead of pollEvents if your application only needs to redraw in response to input
+         */
+        void waitEvents();
+
+        /**
+         * Waits until at least one event is available or the timeout elapses and then processes all pending events
+         * @param timeout Maximum time to wait in seconds, ignored while the window is not visible and the power policy pauses hidden windows
+         */
+        void waitEventsTimeout(double timeout);
+
+        /**
+         * Sets the power policy enforced by waitFrame and waitEventsTimeout
+         * @param policy PowerPolicy
+         */
+        void setPowerPolicy(const PowerPolicy &policy) { _powerPolicy = policy; }
+
+        /**
+         * Paces the frame loop according to the power policy, call it once per frame instead of pollEvents. Events
+         * arriving while waiting are processed (callbacks fire) right away, the call returns when the next frame is due.
+         * While the window is hidden and the policy pauses hidden windows it returns after each batch of events.
+         * Per-poll input (text, motion history, wheel) is gathered over all polls of the frame.
+         */
+        void waitFrame();
+
+        /**
+         * Checks if window should be closed (e.g. user closed the window)
+         * @return True if window should be closed, else returns false
+         * @note Like other getters, this should only be called from the thread that polls events. Use getState() from other threads.
+         */
+        bool shouldClose() const { return _shouldClose; }
+
+        /**
+         * Checks if any part of the window can be seen, false while minimized, unmapped or (X11) fully covered
+         * @return True if the window is visible
+         * @note Rendering can be paused while the window is not visible, waitEvents then sleeps until an event arrives
+         */
+        bool isVisible() const { return _visible; }
+
+        /**
+         * Checks if the window is minimized (iconified)
+         * @return True if the window is minimized
+         */
+        bool isMinimized() const { return _minimized; }
+
+
+        /**
+         * Function returns cursors position in window relative to top left corner
+         * @param x Horizontal position reference
+         * @param y Vertical position reference
+         */
+        void getCursorPosition(unsigned int &x, unsigned int &y) const;
+
+        /**
+         * @brief Function retrieves window position on screen
+         * @param x Horizontal position
+         * @param y Vertical position
+         */
+        void getWindowPosition(unsigned int &x, unsigned int &y) const;
+
+        /**
+         * @brief Function retrieves window size (resolution)
+         * @param width Horizontal resolution in pixels
+         * @param height Vertical resolution in pixels
+         */
+        void getWindowSize(unsigned int &width, unsigned int &height) const;
+
+        /**
+         * Retrieves a consistent snapshot of the window state (size, position, cursor, focus, keys) as published
+         * by the last pollEvents call. Safe to call from any thread, readers never block the event thread.
+         * @return Window state snapshot
+         */
+        WindowState getState() const;
+
+#if defined(SURFER_ENABLE_METRICS)
+        /**
+         * Retrieves event loop metrics accumulated since the window was created. Safe to call from any thread,
+         * the event thread never takes a lock to update them. Individual counters may be one poll apart.
+         * @return Metrics snapshot
+         */
+        Stats getStats() const;
+#endif
+
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32::HWND getNativeWindowPtr() const { return Win32_hWnd; }
+#elif defined(SURFER_PLATFORM_X11)
+        X11::Window getNativeWindowPtr() const { return X11_window; }
+#endif
+
+        /**
+         * Registers a callback that is triggered when a key is pressed. This can be a keyboard key or mouse key or any other.
+         * @param callback KeyPressCallback function
+         */
+        void registerKeyPressCallback(const KeyPressCallback &callback) { this->_keyPressCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when a key is released. This can be a keyboard key or mouse key or any other.
+         * @param callback KeyReleaseCallback function
+         */
+        void registerKeyReleaseCallback(const KeyReleaseCallback &callback) { this->_keyReleaseCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when a held key auto-repeats, used with KeyRepeatMode::Separate
+         * @param callback KeyRepeatCallback function
+         */
+        void registerKeyRepeatCallback(const KeyRepeatCallback &callback) { this->_keyRepeatCallback = callback; }
+
+        /**
+         * Sets how auto-repeat of held keys is reported. Held keys never produce release events in between repeats.
+         * @param mode KeyRepeatMode, KeyRepeatMode::Press by default
+         */
+        void setKeyRepeatMode(KeyRepeatMode mode) { _keyRepeatMode = mode; }
+
+        /**
+         * Sets how keyboard keys are translated to KeyCode. Scancode mode is a single table lookup and works the same
+         * on every layout, use it for game controls (WASD, digits) and getKeyCharacter to label them.
+         * @param mode KeyTranslationMode, KeyTranslationMode::Layout by default
+         */
+        void setKeyTranslationMode(KeyTranslationMode mode) { _keyTranslationMode = mode; }
+
+        /**
+         * Returns the character a physical key produces in the active keyboard layout without modifiers,
+         * e.g. KeyCode::KeyQ gives 'a' on AZERTY. Meant for labeling scancode bindings, text input should use CharacterInputCallback.
+         * @param key Surfer key code (physical position as in KeyTranslationMode::Scancode)
+         * @return Unicode code point or 0 if the key does not produce a character
+         */
+        uint32_t getKeyCharacter(KeyCode key) const;
+
+        /**
+         * Registers a callback that is triggered when character input is provided from an OS.
+         * All text typed since the last poll is delivered at once at the end of pollEvents.
+         * @param callback  CharacterInputCallback function (receives null-terminated utf8 string)
+         * @note This is different from KeyPressCallback which handles key inputs (shortcuts, enter etc.)
+         */
+        void registerCharacterInputCallback(const CharacterInputCallback &callback) {this->_characterInputCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when a mouse is moved (cursor position has changed)
+         * @param callback MouseMotionCallback function
+         */
+        void registerMouseMotionCallback(const MouseMotionCallback &callback);
+
+        /**
+         * Registers a callback that is triggered when the window is resized
+         * @param callback ResizeCallback function
+         */
+        void registerResizeCallback(const ResizeCallback &callback) { this->_resizeCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when the window is moved on the screen.
+         * @param callback MoveCallback function
+         */
+        void registerMoveCallback(const MoveCallback &callback) { this->_moveCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when the window is closed.
+         * @param callback CloseCallback function
+         */
+        void registerCloseCallback(const CloseCallback &callback) { this->_closeCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when a mouse enter (true) or exits (false) the window
+         * @param callback MouseEnterExitCallback function
+         */
+        void registerMouseEnterExitCallback(const MouseEnterExitCallback &callback);
+
+        /**
+         * Registers a callback that is triggered when the window becomes in focus (true) or loses focus (false)
+         * @param callback FocusCallback function
+         */
+        void registerFocusCallback(const FocusCallback &callback) { this->_focusCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when the window becomes hidden (false) or visible again (true)
+         * @param callback OcclusionCallback function
+         */
+        void registerOcclusionCallback(const OcclusionCallback &callback) { this->_occlusionCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when any key is press and native KeySym is passed to the callback
+         * This can be used if a needed key mapping is not supported by Surfer (un-complete mapping or unsupported key)
+         * @param callback NativeKeyPressCallback function
+         */
+        void registerNativeKeyPressCallback(const NativeKeyPressCallback &callback);
+
+        /**
+         * Registers a callback that is triggered when any key is released and native KeySym is passed to the callback
+         * This can be used if a needed key mapping is not supported by Surfer (un-complete mapping or unsupported key)
+         * @param callback NativeKeyReleaseCallback function
+         */
+        void registerNativeKeyReleaseCallback(const NativeKeyReleaseCallback &callback);
+
+        /**
+         * Registers a callback that is triggered when files are dropped onto the window. Paths are delivered in batches
+         * as the data arrives, finished is true for the last batch of a drop. A drop that fails or times out ends with
+         * an empty batch, so every drop ends with finished set.
+         * @param callback FileDropCallback function (paths are valid only during the callback)
+         * @note Supported on X11 (XDND) at the moment
+         */
+        void registerFileDropCallback(const FileDropCallback &callback) { this->_fileDropCallback = callback; }
+
+        /**
+         * Registers a callback that is triggered when a gamepad is connected (true) or disconnected (false)
+         * @param callback GamepadConnectionCallback function
+         */
+        void registerGamepadConnectionCallback(const GamepadConnectionCallback &callback);
+
+        /**
+         * Enables gamepad input. Gamepads are read without blocking during pollEvents, are part of the waitEvents
+         * wait set and are hot-plugged automatically. Gamepads present at this point are reported through the
+         * connection callback right away, so register it first. Calling it again rescans for new devices, which also
+         * picks them up if hot-plug could not be set up.
+         * @note Only supported on Linux (evdev) at the moment. The user needs read access to /dev/input/event*
+         */
+        void enableGamepads();
+
+        /**
+         * Retrieves state of a gamepad with deadzone applied
+         * @param index Gamepad index (0 to MaxGamepads - 1)
+         * @param state Gamepad state, zeroed if the gamepad is not connected
+         * @return True if the gamepad is connected
+         */
+        bool getGamepadState(uint32_t index, GamepadState &state) const;
+
+        /**
+         * Sets the radial stick deadzone (also used for triggers)
+         * @param deadzone Deadzone in <0, 1), default is 0.15
+         */
+        void setGamepadDeadzone(float deadzone) { _gamepadDeadzone = deadzone; }
+
+#if defined(SURFER_PLATFORM_X11)
+        /**
+         * Takes ownership of a selection and offers data for it. Large data is transferred to the pasting
+         * application in chunks (ICCCM INCR), the data is kept until another application takes the selection over.
+         * @param selection Clipboard or Primary selection
+         * @param mimeType Target type, e.g. "UTF8_STRING" for text or any MIME type such as "application/json"
+         * @param data Data to offer
+         */
+        void setClipboard(Selection selection, const std::string &mimeType, std::string data);
+
+        /**
+         * Requests selection data. The request is asynchronous, the callback is triggered from pollEvents/waitEvents
+         * once all data arrived (large transfers arrive in chunks over several polls) so the frame loop never blocks
+         * on the selection owner.
+         * Data this window owns is served locally, without a round trip through the X server.
+         * @param selection Clipboard or Primary selection
+         * @param mimeType Target type, e.g. "UTF8_STRING" for text or any MIME type such as "application/json"
+         * @param callback ClipboardCallback function (data is valid only during the callback)
+         */
+        void requestClipboard(Selection selection, const std::string &mimeType, const ClipboardCallback &callback);
+#endif
+
+#if defined(SURFER_PLATFORM_X11)
+        /**
+         * Acquires a software framebuffer the size of the window for CPU rendered frames (e.g. lavapipe readback,
+         * software rasterizers or headless testing under Xvfb). The pixels live in shared memory with the X server
+         * (MIT-SHM) so presenting does not copy them over the connection, if SHM is unavailable (remote display)
+         * a regular XImage is used instead. The framebuffer is recreated when the window size changes.
+         * @param framebuffer Framebuffer description, pixels are valid until the next acquire
+         * @return False if the previous frame is still being presented (process events and try again) or on failure
+         */
+        bool acquireFramebuffer(Framebuffer &framebuffer) { return X11_acquireFramebuffer(framebuffer); }
+
+        /**
+         * Presents the software framebuffer acquired by acquireFramebuffer
+         */
+        void presentFramebuffer() { X11_presentFramebuffer(); }
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+        /**
+         * Adds a file descriptor (socket, pipe, inotify...) to the window event loop. It is waited on together
+         * with the window events by waitEvents and its callback is triggered from pollEvents/waitEvents when ready.
+         * @param fd File descriptor, ownership stays with the caller
+         * @param events epoll event mask (e.g. EPOLLIN)
+         * @param callback FileDescriptorCallback function (receives the fd and ready events), must not be empty
+         * @return True on success
+         */
+        bool addFileDescriptor(int fd, uint32_t events, const FileDescriptorCallback &callback);
+
+        /**
+         * Removes a file descriptor previously added by addFileDescriptor. Safe to call from within its callback.
+         * @param fd File descriptor
+         */
+        void removeFileDescriptor(int fd) { X11_removeSource(fd, false); }
+
+        /**
+         * Adds a timer to the window event loop. Its callback is triggered from pollEvents/waitEvents when it expires
+         * and waitEvents wakes up for it.
+         * @param delay Time until the first expiration in seconds
+         * @param interval Repeat interval in seconds, 0 for a one-shot timer that is removed after it fires
+         * @param callback TimerCallback function, must not be empty
+         * @return Timer id or -1 on failure
+         */
+        int addTimer(double delay, double interval, const TimerCallback &callback);
+
+        /**
+         * Removes a timer. Safe to call from within its callback.
+         * @param timer Timer id returned by addTimer
+         */
+        void removeTimer(int timer) { X11_removeSource(timer, true); }
+#endif
+
+        /**
+         * Returns text input (utf8) gathered during the last poll, or during the whole frame with waitFrame
+         * @return Span over the utf8 bytes, valid until the next poll (next waitFrame)
+         */
+        Span<char> getTextInput() const { return Span<char>(_textInput.data(), _textInput.size()); }
+
+        /**
+         * Waits for the next key (keyboard or mouse) press, use as co_await window->nextKey() with VulkanSurferCoroutines.h
+         * @return Awaitable resolving to the pressed KeyCode
+         */
+        KeyWait nextKey() { return KeyWait{this}; }
+
+        /**
+         * Waits for the next resize, use as co_await window->resized() with VulkanSurferCoroutines.h
+         * @return Awaitable resolving to the new size
+         */
+        ResizeWait resized() { return ResizeWait{this}; }
+
+        /**
+         * Waits for the given time, use as co_await window->sleepFor(ms) with VulkanSurferCoroutines.h.
+         * The waiter is resumed from the first poll after the time elapsed, waitEvents wakes up for it.
+         * @param milliseconds Time to wait
+         * @return Awaitable
+         */
+        SleepWait sleepFor(uint32_t milliseconds) { return SleepWait{this, milliseconds}; }
+
+        /**
+         * Adds a waiter resumed from the event loop on the next key press (one-shot)
+         * @param waiter Waiter, must stay alive until resumed or removed
+         */
+        void addKeyWaiter(EventWaiter *waiter) { pushWaiter(_keyWaiters, waiter); }
+
+        /**
+         * Adds a waiter resumed from the event loop on the next resize (one-shot)
+         * @param waiter Waiter, must stay alive until resumed or removed
+         */
+        void addResizeWaiter(EventWaiter *waiter) { pushWaiter(_resizeWaiters, waiter); }
+
+        /**
+         * Adds a waiter resumed from the event loop once its deadline passed (one-shot)
+         * @param waiter Waiter with deadline set, must stay alive until resumed or removed
+         */
+        void addTimerWaiter(EventWaiter *waiter) { pushWaiter(_timerWaiters, waiter); }
+
+        /**
+         * Removes a waiter that has not been resumed yet, also one whose event is being dispatched right now
+         * @param waiter Waiter
+         */
+        void removeWaiter(EventWaiter *waiter);
+
+        /**
+         * Returns the modifier keys currently held
+         * @return ModifierFlags
+         */
+        ModifierFlags getModifiers() const;
+
+        /**
+         * Attaches a shortcut map, it is fed every key and mouse button press reported to the key press callback
+         * @param shortcuts Shortcut map, not owned, must stay alive until detached with nullptr
+         */
+        void setShortcutMap(ShortcutMap *shortcuts) { _shortcutMap = shortcuts; }
+
+        /**
+         * Enables recording of every pointer motion sample, not just the latest position. Forces full pointer motion
+         * events on X11.
+         * @param capacity Maximum samples kept per poll, the oldest are overwritten beyond it. 0 disables the history.
+         */
+        void enableMotionHistory(uint32_t capacity = 1024u);
+
+        /**
+         * Returns pointer motion samples gathered during the last poll, or during the whole frame with waitFrame,
+         * oldest first. Samples beyond the capacity overwrite the oldest ones.
+         * @return Span over the samples, valid until the next poll (next waitFrame)
+         */
+        Span<MotionSample> getMotionHistory() const { return Span<MotionSample>(_motionHistory.data(), _motionCount); }
+
+        /**
+         * Returns how far the wheel was scrolled during the last poll, or during the whole frame with waitFrame
+         * @return Wheel steps (notches), positive away from the user
+         */
+        float getWheelDelta() const { return _wheel; }
+
+        VkResult createSurface(VkInstance instance, VkSurfaceKHR *surface);
+
+        /**
+         * Returns instance extensions required by createSurface
+         * @return Span over a static array of extension names
+         */
+        static Span<const char *> getRequiredInstanceExtensions();
+
+        /**
+         * Checks if a queue family can present to this window's display, usable for device selection before the surface exists
+         * @param physicalDevice Physical device
+         * @param queueFamilyIndex Queue family index
+         * @return True if the queue family supports presentation
+         */
+        bool getPresentationSupport(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex) const;
+
+        /**
+         * Returns surface capabilities, cached per (physical device, surface) until the window is resized or the monitor configuration changes
+         * @param physicalDevice Physical device
+         * @param surface Surface created by createSurface
+         * @param capabilities Receives the capabilities
+         * @return Result of vkGetPhysicalDeviceSurfaceCapabilitiesKHR
+         */
+        VkResult getSurfaceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                        VkSurfaceCapabilitiesKHR *capabilities);
+
+        /**
+         * Returns supported surface formats, cached per (physical device, surface) until the monitor configuration changes
+         * @param physicalDevice Physical device
+         * @param surface Surface created by createSurface
+         * @param formats Receives a span over the cached formats, valid until the cache is invalidated
+         * @return Result of vkGetPhysicalDeviceSurfaceFormatsKHR
+         */
+        VkResult getSurfaceFormats(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                   Span<VkSurfaceFormatKHR> *formats);
+
+        /**
+         * Returns supported present modes, cached per (physical device, surface) until the monitor configuration changes
+         * @param physicalDevice Physical device
+         * @param surface Surface created by createSurface
+         * @param presentModes Receives a span over the cached present modes, valid until the cache is invalidated
+         * @return Result of vkGetPhysicalDeviceSurfacePresentModesKHR
+         */
+        VkResult getSurfacePresentModes(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                        Span<VkPresentModeKHR> *presentModes);
+
+        /**
+         * Drops cached surface queries, call this before destroying a surface (handles may be reused)
+         * @param surface Surface to forget, VK_NULL_HANDLE drops everything
+         */
+        void invalidateSurfaceCache(VkSurfaceKHR surface = VK_NULL_HANDLE);
+
+        /**
+         * Returns the callbacks given to createWindow, pass them to vkDestroySurfaceKHR
+         * @return Allocation callbacks or nullptr
+         */
+        const VkAllocationCallbacks *getAllocationCallbacks() const { return _allocator; }
+
+    protected:
+        explicit Window(const VkAllocationCallbacks *allocator);
+
+        ~Window();
+
+        Result create(const std::string &title, const uint32_t width, const uint32_t height,
+                      const int32_t x, const int32_t y);
+
+        // Memory, declared first so the containers below can use it
+        VkAllocationCallbacks _allocationCallbacks;
+        const VkAllocationCallbacks *_allocator;
+
+        // State
+        bool _shouldClose = false;
+        uint32_t _width = 0u, _height = 0u;
+        int32_t _x = 0, _y = 0;
+        uint32_t _mouse_x = 0u, _mouse_y = 0u;
+        bool _focused = false, _mouseEntered = false;
+        bool _visible = true, _minimized = false;
+        PowerPolicy _powerPolicy{};
+        std::chrono::steady_clock::time_point _nextFrame{};
+        String _title{_allocator};
+        String _textInput{_allocator}; // utf8 text gathered during one poll
+        Vector<MotionSample> _motionHistory{_allocator}; // ring of samples gathered during one poll
+        size_t _motionCount = 0, _motionHead = 0;
+        float _wheel = 0.0f; // gathered during one poll
+        size_t _textDispatched = 0; // bytes of _textInput already passed to the character callback
+        bool _keepPollInput = false; // set during waitFrame, its polls append to the input of the frame
+        uint64_t _keys[sizeof(WindowState::keys) / sizeof(uint64_t)] = {};
+        uint64_t _pressedKeys[sizeof(WindowState::keys) / sizeof(uint64_t)] = {}; // gathered during one poll
+
+        // State published for other threads (seqlock, odd sequence means write in progress)
+        static const uint32_t StateWordCount = (sizeof(WindowState) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        std::atomic<uint32_t> _stateSequence{0u};
+        std::atomic<uint32_t> _stateWords[StateWordCount] = {};
+
+        void setKeyState(KeyCode key, bool down);
+
+        void publishState();
+
+        // Surface queries, usually one or two entries so a linear search is fine
+        struct SurfaceCacheEntry {
+            VkPhysicalDevice physicalDevice;
+            VkSurfaceKHR surface;
+            bool capabilitiesValid, formatsValid, presentModesValid;
+            VkSurfaceCapabilitiesKHR capabilities;
+            Vector<VkSurfaceFormatKHR> formats;
+            Vector<VkPresentModeKHR> presentModes;
+        };
+        Vector<SurfaceCacheEntry> _surfaceCache{_allocator};
+
+        SurfaceCacheEntry &findSurfaceCacheEntry(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface);
+
+        template<typename T>
+        static VkResult enumerateSurface(VkResult (VKAPI_PTR *query)(VkPhysicalDevice, VkSurfaceKHR, uint32_t *, T *),
+                                         VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, Vector<T> &out);
+
+        void invalidateSurfaceExtent();
+
+        void invalidateSurfaceMonitor();
+
+#if defined(SURFER_ENABLE_METRICS)
+        // Written by the event thread only, so plain relaxed load/store instead of read-modify-write
+        struct Metrics {
+            std::atomic<uint64_t> polls{0u};
+            std::atomic<uint64_t> events[EventTypeCount] = {};
+            std::atomic<uint64_t> pollDuration[HistogramBucketCount] = {};
+            std::atomic<uint64_t> eventDuration[HistogramBucketCount] = {};
+            std::atomic<uint32_t> maxQueueDepth{0u};
+        } _metrics;
+
+        typedef std::chrono::steady_clock MetricsClock;
+
+        static void metricsIncrement(std::atomic<uint64_t> &counter);
+
+        static void metricsRecordDuration(std::atomic<uint64_t> (&histogram)[HistogramBucketCount],
+                                          MetricsClock::time_point start);
+
+        void metricsRecordPoll(MetricsClock::time_point start, uint32_t queueDepth);
+
+        void metricsRecordEvent(EventType type, MetricsClock::time_point start);
+#endif
+
+        // Linux evdev key codes (input-event-codes.h), also PC set 1 scancodes for keys without the E0 prefix
+        static const uint32_t ScancodeCount = 127u;
+
+        static KeyCode translateScancode(uint32_t scancode);
+
+        // Waiters are one-shot, each list is moved to _resumingWaiters before resuming so a resumed waiter can wait
+        // again right away. Waiters are taken from there one by one, a resumed coroutine may remove the others.
+        EventWaiter *_keyWaiters = nullptr;
+        EventWaiter *_resizeWaiters = nullptr;
+        EventWaiter *_timerWaiters = nullptr;
+        EventWaiter *_resumingWaiters = nullptr;
+
+        static void pushWaiter(EventWaiter *&list, EventWaiter *waiter);
+
+        // Unlinks the next waiter to resume, nullptr when done
+        EventWaiter *popResumingWaiter();
+
+        // Cancels all pending waiters, the window is going away
+        void cancelWaiters();
+
+        void resumeKeyWaiters(KeyCode key);
+
+        void resumeResizeWaiters(uint32_t width, uint32_t height);
+
+        // Also ends timed out shortcut chords
+        void resumeTimerWaiters();
+
+        // Shortens a wait timeout in milliseconds (-1 infinite) to the earliest timer waiter or chord timeout
+        int clampToTimerWaiters(int timeout) const;
+
+        ShortcutMap *_shortcutMap = nullptr;
+
+        void dispatchShortcut(KeyCode key);
+
+        void recordMotionSample(int32_t x, int32_t y, uint64_t time);
+
+        // Checks the budget of pollEvents(maxEvents, maxMicros) before processing another event
+        static bool withinBudget(uint32_t processed, uint32_t maxEvents, uint32_t maxMicros,
+                                 std::chrono::steady_clock::time_point start);
+
+        // Makes the samples of this poll contiguous
+        void finishMotionHistory();
+
+        void setVisibility(bool visible, bool minimized);
+
+        // Events that have no consumer are not selected, so the server never sends them
+        void updateEventMask();
+
+        // Returns true if the repeat should be reported as a regular key press
+        bool dispatchKeyRepeat(KeyCode key);
+
+        // Clears the input gathered per poll, unless waitFrame gathers it for the whole frame
+        void beginPollInput();
+
+        void dispatchTextInput();
+
+        // Callbacks
+        KeyPressCallback _keyPressCallback = nullptr;
+        CharacterInputCallback _characterInputCallback = nullptr;
+        KeyReleaseCallback _keyReleaseCallback = nullptr;
+        KeyRepeatCallback _keyRepeatCallback = nullptr;
+        KeyRepeatMode _keyRepeatMode = KeyRepeatMode::Press;
+        KeyTranslationMode _keyTranslationMode = KeyTranslationMode::Layout;
+        MouseMotionCallback _mouseMotionCallback = nullptr;
+        ResizeCallback _resizeCallback = nullptr;
+        MoveCallback _moveCallback = nullptr;
+        CloseCallback _closeCallback = nullptr;
+        MouseEnterExitCallback _mouseEnterExitCallback = nullptr;
+        FocusCallback _focusCallback = nullptr;
+        OcclusionCallback _occlusionCallback = nullptr;
+        NativeKeyPressCallback _nativeKeyPressCallback = nullptr;
+        NativeKeyReleaseCallback _nativeKeyReleaseCallback = nullptr;
+        GamepadConnectionCallback _gamepadConnectionCallback = nullptr;
+        FileDropCallback _fileDropCallback = nullptr;
+
+        float _gamepadDeadzone = 0.15f;
+
+        void applyGamepadDeadzone(GamepadState &state) const;
+
+
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32::HWND Win32_hWnd = nullptr;
+        Win32::HINSTANCE Win32_hInstance = nullptr;
+        bool Win32_resizing = false;
+
+
+        Result Win32_createWindow(const std::string &title, const uint32_t width,
+                                  const uint32_t height, const int32_t x, const int32_t y);
+
+        void Win32_destroyWindow();
+
+        VkResult Win32_CreateSurface(VkInstance instance, VkSurfaceKHR *surface) const;
+
+        bool Win32_pollEvents(uint32_t maxEvents = UINT32_MAX, uint32_t maxMicros = UINT32_MAX);
+
+#if defined(SURFER_ENABLE_METRICS)
+        static EventType Win32_eventType(Win32::UINT message);
+#endif
+
+        void Win32_waitEvents(Win32::DWORD timeout);
+
+        /// internal window procedure function for Win32 API
+        static Win32::LRESULT __stdcall WndProc(Win32::HWND hWnd, Win32::UINT uMsg, Win32::WPARAM wParam, Win32::LPARAM lParam);
+
+        void Win32_onMouseEnter();
+
+
+        void Win32_onMouseLeave();
+
+        void Win32_onCharInput(Win32::WPARAM wParam);
+
+        KeyCode Win32_translateKey(Win32::WPARAM key, Win32::LPARAM lParam);
+
+        // Set 1 scancodes match evdev codes except for the E0 prefixed (extended) keys
+        static uint32_t Win32_scancodeToEvdev(uint32_t scancode, bool extended);
+
+        static uint32_t Win32_getKeyCharacter(uint32_t evdev);
+
+        void Win32_onKeyDown(Win32::WPARAM key, Win32::LPARAM lParam);
+
+        void Win32_onKeyUp(Win32::WPARAM key, Win32::LPARAM lParam);
+
+        void Win32_onClose();
+
+        void Win32_onDestroy();
+
+        void Win32_onMouseMove(int xPos, int yPos);
+
+        void Win32_onButtonPress(Win32::UINT button);
+
+        void Win32_onButtonRelease(Win32::UINT button);
+
+        KeyCode Win32_translateButton(Win32::UINT button);
+
+        void Win32_onResize(uint32_t width, uint32_t height);
+
+        void Win32_onMove(Win32::LPARAM lParam);
+
+        void Win32_onDpiChange(Win32::HWND hWnd, Win32::WPARAM wParam, Win32::LPARAM lParam);
+
+        void Win32_onFocusIn();
+
+        void Win32_onFocusOut();
+
+        KeyCode Win32_translateKeyCode(Win32::WPARAM key);
+
+
+#elif defined(SURFER_PLATFORM_X11)
+        X11::Display *X11_display = nullptr;
+        X11::Window X11_window = 0;
+        X11::Window X11_root = 0;
+        X11::Atom X11_wmDeleteMessage = 0;
+        X11::XIC X11_xic = nullptr;
+
+        Result X11_createWindow(const std::string &title, const uint32_t width,
+                                const uint32_t height, const int32_t x, const int32_t y);
+
+        void X11_destroyWindow();
+
+        VkResult X11_CreateSurface(VkInstance instance, VkSurfaceKHR *surface);
+
+        void X11_pollEvents();
+
+        void X11_waitEvents(int timeout);
+
+        bool X11_processEvents(int timeout, uint32_t maxEvents = UINT32_MAX, uint32_t maxMicros = UINT32_MAX);
+
+        void X11_dispatchEvent(X11::XEvent &event);
+
+        // Pulls close requests and the latest configure out of the queue ahead of everything else
+        void X11_processPriorityEvents();
+
+        static int X11_isCloseRequest(X11::Display *, X11::XEvent *event, X11::XPointer arg);
+
+#if defined(SURFER_ENABLE_METRICS)
+        static EventType X11_eventType(int type);
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+        // Kind of an epoll source, stored in the upper half of epoll_event::data.u64, fd in the lower half
+        enum X11_SourceKind : uint32_t {
+            X11_SourceDisplay, X11_SourceHotplug, X11_SourceGamepad, X11_SourceUser
+        };
+
+        struct X11_EventSource {
+            int fd;
+            uint32_t events;
+            bool removed;
+            bool oneShot;
+            FileDescriptorCallback fdCallback;
+            TimerCallback timerCallback;
+        };
+
+        int X11_epollFd = -1; // -1 if epoll is unavailable, the sources are then waited on with poll()
+        Vector<X11_EventSource> X11_sources{_allocator};
+        Vector<::pollfd> X11_pollFds; // initialized by the constructor, pollfd is incomplete without the native headers
+
+        static timespec X11_toTimespec(double seconds);
+
+        bool X11_watch(int fd, uint32_t events, X11_SourceKind kind);
+
+        void X11_unwatch(int fd);
+
+        bool X11_addSource(int fd, uint32_t events, const FileDescriptorCallback &fdCallback,
+                           const TimerCallback &timerCallback);
+
+        void X11_removeSource(int fd, bool timer);
+
+        void X11_dispatchSources(int timeout);
+
+        /// Fallback of X11_dispatchSources without an epoll instance
+        void X11_pollSources(int timeout);
+
+        void X11_dispatchSource(X11_SourceKind kind, int fd, uint32_t events);
+
+        void X11_dispatchUserSource(int fd, uint32_t events);
+#endif
+
+        void X11_processEvent(X11::XEvent event);
+
+        void X11_onClose();
+
+        long X11_selectedEventMask = 0; // NoEventMask
+
+        long X11_eventMask() const;
+
+        void X11_updateEventMask();
+
+        bool X11_mapped = true, X11_obscured = false, X11_hidden = false;
+
+        void X11_updateVisibility();
+
+        // Window managers mark minimized windows with _NET_WM_STATE_HIDDEN
+        void X11_onWmStateChange();
+
+        void X11_onKeyPress(X11::XEvent &event);
+
+        bool X11_detectableAutoRepeat = false;
+        uint64_t X11_heldKeycodes[4] = {}; // bit per X11 keycode (8-255)
+
+        bool X11_isKeycodeHeld(unsigned int keycode) const;
+
+        void X11_setKeycodeHeld(unsigned int keycode, bool held);
+
+        // Without detectable auto-repeat (server lacks XKB) a repeat is a release immediately followed by a press
+        // of the same key with the same timestamp
+        bool X11_isRepeatRelease(const X11::XEvent &event);
+
+        void X11_lookupText(X11::XEvent &event);
+
+        void X11_onKeyRelease(unsigned int x11KeyCode);
+
+        KeyCode X11_translateKey(unsigned int x11KeyCode);
+
+        uint32_t X11_getKeyCharacter(uint32_t scancode) const;
+
+        void X11_onButtonPress(unsigned int x11button);
+
+        void X11_onButtonRelease(unsigned int x11button);
+
+        KeyCode X11_translateButton(unsigned int x11button);
+
+        void X11_onMove(int32_t x, int32_t y);
+
+        void X11_onResize(const uint32_t width, const uint32_t height);
+
+        void X11_onMouseMotion(uint32_t x, uint32_t y);
+
+        void X11_onFocusIn();
+
+        void X11_onFocusOut();
+
+        void X11_onMouseEnter();
+
+        void X11_onMouseLeave();
+
+        // Atoms used by selections, interned once in a single round trip
+        struct X11_Atoms {
+            X11::Atom clipboard, targets, incr, utf8String, textPlainUtf8, textPlain, selectionProperty;
+            X11::Atom wmProtocols, xdndAware, xdndEnter, xdndPosition, xdndStatus, xdndLeave, xdndDrop, xdndFinished;
+            X11::Atom xdndSelection, xdndTypeList, xdndActionCopy, uriList;
+            X11::Atom netWmState, netWmStateHidden;
+        } X11_atoms = {};
+
+        // Data we offer for a selection we own
+        struct X11_SelectionOffer {
+            X11::Atom target;
+            std::shared_ptr<const String> data;
+        };
+
+        // Outgoing INCR transfer to another client, advanced every time the requestor deletes the property
+        struct X11_SelectionWrite {
+            X11::Window requestor;
+            X11::Atom property;
+            X11::Atom target;
+            size_t offset;
+            std::shared_ptr<const String> data;
+            std::chrono::steady_clock::time_point lastActivity;
+        };
+
+        // Incoming transfer, requests are served one at a time through a single property
+        struct X11_SelectionRead {
+            X11::Atom selection;
+            X11::Atom target;
+            X11::Time time;
+            bool started;
+            bool incremental;
+            bool drop; // data is parsed and delivered as it arrives instead of being collected
+            bool local; // served from our own offer, finished by the next poll without asking the server
+            String data;
+            ClipboardCallback callback;
+            std::chrono::steady_clock::time_point lastActivity;
+        };
+
+        X11_SelectionOffer X11_offers[2] = {};
+        Vector<X11_SelectionWrite> X11_selectionWrites{_allocator};
+        Vector<X11_SelectionRead> X11_selectionReads{_allocator};
+        size_t X11_maxChunkSize = 0u;
+
+        // Transfers whose peer did not respond for this long are dropped
+        static std::chrono::seconds X11_selectionTimeout() { return std::chrono::seconds(5); }
+
+        void X11_internAtoms();
+
+        X11::Atom X11_selectionAtom(Selection selection) const;
+
+        X11_SelectionOffer *X11_findOffer(X11::Atom selection);
+
+        bool X11_offerProvides(const X11_SelectionOffer &offer, X11::Atom target) const;
+
+        /// Errors are expected when talking to other clients (e.g. requestor window destroyed meanwhile)
+        static int &X11_trappedError();
+
+        // Keeps the handler installed before X11_trapErrors, defined with the implementation (Xlib types)
+        struct X11_ErrorTrap;
+
+        X11_ErrorTrap X11_trapErrors();
+
+        int X11_untrapErrors(const X11_ErrorTrap &trap);
+
+        void X11_setSelection(Selection selection, const std::string &mimeType, std::string data);
+
+        void X11_onSelectionClear(const X11::XEvent &event);
+
+        void X11_onSelectionRequest(const X11::XEvent &event);
+
+        void X11_startSelectionWrite(X11::Window requestor, X11::Atom property, X11::Atom target,
+                                     const std::shared_ptr<const String> &data);
+
+        void X11_continueSelectionWrite(const X11::XEvent &event);
+
+        void X11_requestSelection(Selection selection, const std::string &mimeType, const ClipboardCallback &callback);
+
+        void X11_startSelectionRead();
+
+        void X11_finishSelectionRead(bool success);
+
+        /// Reads and deletes the selection property, returns false if the property type is not the expected one
+        bool X11_readSelectionProperty(X11::Atom &type, String &data);
+
+        void X11_onSelectionNotify(const X11::XEvent &event);
+
+        /// Finishes reads served from our own offers, called from every poll
+        void X11_finishLocalSelectionReads();
+
+        /// Stops listening to a requestor once it has no writes left
+        void X11_releaseRequestor(X11::Window requestor);
+
+        /// Drops transfers whose peer stopped responding, called from every poll
+        void X11_expireSelectionTransfers();
+
+        /// Shortens the wait so a stalled transfer expires on time
+        int X11_clampToSelectionTimeout(int timeout) const;
+
+        void X11_onPropertyNotify(const X11::XEvent &event);
+
+        // XDND protocol version we implement
+        static const int X11_xdndVersion = 5;
+
+        // State of a drag currently over the window
+        struct X11_DragState {
+            X11::Window source;
+            int version;
+            bool accepted; // source offers text/uri-list
+        } X11_drag = {};
+
+        String X11_dropPaths{_allocator}; // decoded paths of one batch, null separated
+        Vector<const char *> X11_dropPathPointers{_allocator};
+
+        void X11_onClientMessage(const X11::XEvent &event);
+
+        void X11_sendDragMessage(X11::Window target, X11::Atom type, long data1, long data2, long data4);
+
+        static void X11_ignoreDragSourceErrors(X11::Window source);
+
+        void X11_onDragEnter(const X11::XEvent &event);
+
+        void X11_onDragPosition(const X11::XEvent &event);
+
+        void X11_onDrop(const X11::XEvent &event);
+
+        void X11_finishDrop(bool success);
+
+        static int X11_hexValue(char c);
+
+        /// Appends a decoded local path for file uris, other uris are passed through unchanged
+        void X11_appendDropPath(const char *uri, size_t length);
+
+        /// Delivers all complete lines of the uri list and keeps the trailing partial line for the next chunk
+        void X11_processDropData(String &data, bool last);
+
+        // Defined with the implementation (Xlib and MIT-SHM types), allocated by the first acquire
+        struct X11_SoftwareFramebuffer;
+        X11_SoftwareFramebuffer *X11_framebuffer = nullptr;
+
+        int X11_shmCompletionEvent = -1;
+
+        void X11_destroyFramebuffer();
+
+        bool X11_createShmFramebuffer(int screen);
+
+        bool X11_createFramebuffer();
+
+        bool X11_acquireFramebuffer(Framebuffer &framebuffer);
+
+        void X11_presentFramebuffer();
+
+#if defined(SURFER_GAMEPAD_EVDEV)
+        struct X11_GamepadDevice {
+            int fd = -1;
+            char path[64] = {}; // /dev/input/eventN, longer names are skipped
+            uint32_t analogAxes = 0u; // bit per GamepadAxis reported as absolute axis
+            bool dropped = false; // kernel buffer overflowed, waiting for SYN_REPORT to resync
+            int32_t axisMinimum[GamepadAxisCount] = {};
+            int32_t axisMaximum[GamepadAxisCount] = {};
+            GamepadState state{};
+        };
+
+        X11_GamepadDevice X11_gamepads[MaxGamepads];
+        int X11_inotifyFd = -1;
+
+        static bool X11_testBit(const unsigned long *bits, uint32_t bit);
+
+        static int X11_gamepadAxis(uint16_t code);
+
+        static int X11_gamepadButton(uint16_t code);
+
+        static void X11_setGamepadButton(GamepadState &state, GamepadButton button, bool down);
+
+        void X11_enableGamepads();
+
+        void X11_openGamepad(const char *path);
+
+        void X11_closeGamepad(uint32_t index);
+
+        /// Re-reads the full device state, used on connect and after the kernel dropped events
+        void X11_syncGamepad(X11_GamepadDevice &pad);
+
+        void X11_processGamepadKey(X11_GamepadDevice &pad, uint16_t code, int32_t value);
+
+        void X11_processGamepadAxis(X11_GamepadDevice &pad, uint16_t code, int32_t value);
+
+        void X11_readGamepad(uint32_t index);
+
+        void X11_processGamepadHotplug();
+
+#endif
+
+        KeyCode X11_translateKeyCode(X11::KeySym keySym);
+
+
+#endif
+    };
+
+    /**
+     * Optional swapchain helper built on Window::createSurface. Recreates itself when the window size changes or the
+     * surface goes out of date, passing the previous swapchain as oldSwapchain, and destroys retired swapchains once
+     * the fences of frames rendered to them have signaled, so a resize never needs vkDeviceWaitIdle.
+     */
+    class Swapchain {
+    public:
+        Swapchain() = delete;
+        Swapchain(const Swapchain &) = delete;
+        Swapchain(Swapchain &&) = delete;
+        Swapchain &operator=(const Swapchain &) = delete;
+        Swapchain &operator=(Swapchain &&) = delete;
+
+        /**
+         * Creates a swapchain for a window surface
+         * @param window Window the surface was created for, must outlive the swapchain
+         * @param physicalDevice Physical device
+         * @param device Logical device
+         * @param surface Surface created by Window::createSurface
+         * @param settings Swapchain settings
+         * @return Swapchain pointer, throws std::runtime_error on failure (returns nullptr with SURFER_NO_EXCEPTIONS)
+         */
+        static Swapchain *createSwapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device,
+                                          VkSurfaceKHR surface, const SwapchainSettings &settings = SwapchainSettings());
+
+        /**
+         * Creates a swapchain for a window surface without throwing
+         * @param window Window the surface was created for, must outlive the swapchain
+         * @param physicalDevice Physical device
+         * @param device Logical device
+         * @param surface Surface created by Window::createSurface
+         * @param out Receives the swapchain pointer, nullptr on failure
+         * @param settings Swapchain settings
+         * @return VK_SUCCESS, VK_NOT_READY if the window is minimized (images are created by a later acquire), else the error
+         */
+        static VkResult tryCreateSwapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device,
+                                           VkSurfaceKHR surface, Swapchain **out,
+                                           const SwapchainSettings &settings = SwapchainSettings());
+
+        /**
+         * Destroys a swapchain together with the retired ones that were not collected yet, without waiting for any
+         * fence. The device must not be using any of their images, wait for the frame fences or call vkDeviceWaitIdle first.
+         * @param swapchain Swapchain pointer
+         */
+        static void destroySwapchain(const Swapchain *swapchain);
+
+        /**
+         * Acquires the next image, recreating the swapchain first if the window was resized or the surface is out of date
+         * @param semaphore Semaphore signaled when the image is ready
+         * @param fence Fence signaled when the image is ready, may be VK_NULL_HANDLE
+         * @param imageIndex Receives the image index
+         * @return VK_SUCCESS or VK_SUBOPTIMAL_KHR with an image, VK_NOT_READY if the window has no area (minimized), else an error
+         */
+        VkResult acquireNextImage(VkSemaphore semaphore, VkFence fence, uint32_t *imageIndex);
+
+        /**
+         * Presents an acquired image
+         * @param queue Queue with presentation support
+         * @param semaphore Semaphore signaled when rendering to the image finished
+         * @param imageIndex Index returned by acquireNextImage
+         * @param fence Fence of the submission that rendered the image, used to know when a retired swapchain can be
+         * destroyed. Pass it every frame, a retired swapchain is kept until a fence of a frame presented to it (or after
+         * it, if none was) has signaled, without fences retired swapchains are only destroyed with this object.
+         * @return VK_SUCCESS if presented (out of date surfaces are recreated on the next acquire), else an error
+         */
+        VkResult present(VkQueue queue, VkSemaphore semaphore, uint32_t imageIndex, VkFence fence);
+
+        /**
+         * Registers callback that is called after the swapchain was recreated, rebuild image views and framebuffers here
+         * @param callback SwapchainRecreateCallback function
+         */
+        void registerRecreateCallback(const SwapchainRecreateCallback &callback) { _recreateCallback = callback; }
+
+        VkSwapchainKHR getSwapchain() const { return _swapchain; }
+        VkFormat getFormat() const { return _format.format; }
+        VkColorSpaceKHR getColorSpace() const { return _format.colorSpace; }
+        VkPresentModeKHR getPresentMode() const { return _presentMode; }
+        VkExtent2D getExtent() const { return _extent; }
+        Span<VkImage> getImages() const { return Span<VkImage>(_images.data(), _images.size()); }
+
+    protected:
+        Swapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface,
+                  const SwapchainSettings &settings);
+
+        ~Swapchain();
+
+        struct Retired {
+            VkSwapchainKHR swapchain;
+            Vector<VkFence> fences; // fences of frames rendered to its images, empty until one is known
+        };
+
+        Window *_window;
+        const VkAllocationCallbacks *_allocator; // the window callbacks
+        VkPhysicalDevice _physicalDevice;
+        VkDevice _device;
+        VkSurfaceKHR _surface;
+        SwapchainSettings _settings;
+
+        VkSwapchainKHR _swapchain = VK_NULL_HANDLE;
+        VkSurfaceFormatKHR _format = {};
+        VkPresentModeKHR _presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        VkExtent2D _extent = {};
+        unsigned int _windowWidth = 0u, _windowHeight = 0u;
+        bool _recreate = false;
+        Vector<VkImage> _images;
+        Vector<VkFence> _fences;
+        Vector<Retired> _retired;
+        SwapchainRecreateCallback _recreateCallback = nullptr;
+
+        void collectRetired();
+
+        VkSurfaceFormatKHR chooseFormat(Span<VkSurfaceFormatKHR> formats) const;
+
+        VkPresentModeKHR choosePresentMode(Span<VkPresentModeKHR> presentModes) const;
+
+        VkResult recreate();
+    };
+}
+
+#endif //VULKANSURFER_H
+
+#if !defined(SURFER_SPLIT_IMPLEMENTATION) || defined(SURFER_IMPLEMENTATION)
+#ifndef VULKANSURFER_IMPLEMENTATION_H
+#define VULKANSURFER_IMPLEMENTATION_H
+
+// Platform-specific includes
+#if defined(SURFER_PLATFORM_WIN32)
+#include <windows.h>
+#include <windowsx.h>
+#include <vulkan/vulkan_win32.h>
+#endif
+
+#if defined(SURFER_PLATFORM_X11)
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/XKBlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <vulkan/vulkan_xlib.h>
+#include <poll.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#undef None
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdio>
+#endif
+
+namespace Surfer {
+#if defined(SURFER_PLATFORM_X11)
+    struct Window::X11_ErrorTrap {
+        XErrorHandler previous;
+
+        static int handler(Display *, XErrorEvent *event) {
+            X11_trappedError() = event->error_code;
+            return 0;
+        }
+
+        // Recent drag sources, XdndStatus goes to them without a round trip and the
+        // source may be gone by the time the error arrives
+        struct DragSources {
+            XErrorHandler previous = nullptr;
+            ::Window windows[4] = {};
+            unsigned next = 0;
+        };
+
+        static DragSources &dragSources() {
+            static DragSources sources;
+            return sources;
+        }
+
+        static int dragHandler(Display *display, XErrorEvent *event) {
+            const DragSources &sources = dragSources();
+            if (event->error_code == BadWindow) {
+                for (::Window window : sources.windows) {
+                    if (window != 0 && event->resourceid == window) {
+                        return 0;
+                    }
+                }
+            }
+            return sources.previous != nullptr ? sources.previous(display, event) : 0;
+        }
+    };
+
+    struct Window::X11_SoftwareFramebuffer {
+        XImage *image = nullptr;
+        XShmSegmentInfo shm = {};
+        GC gc = nullptr;
+        bool useShm = false;
+        bool pending = false; // waiting for ShmCompletion, the server may still read the pixels
+    };
+#endif
+
+    SURFER_DEF Window *Window::createWindow(const std::string &title, const uint32_t width,
+                                            const uint32_t height, const int32_t x, const int32_t y,
+                                            const VkAllocationCallbacks *allocator) {
+        Window *window = nullptr;
+        const Result result = tryCreateWindow(title, width, height, x, y, &window, allocator);
+#if defined(SURFER_NO_EXCEPTIONS)
+        (void) result;
+#else
+        if (result != Result::Ok) {
+            throw std::runtime_error(std::string("VulkanSurfer: ") + getResultString(result));
+        }
+#endif
+        return window;
+    }
+
+    SURFER_DEF Result Window::tryCreateWindow(const std::string &title, const uint32_t width,
+                                              const uint32_t height, const int32_t x, const int32_t y, Window **out,
+                                              const VkAllocationCallbacks *allocator) {
+        *out = nullptr;
+        if (width == 0 || height == 0) {
+            return Result::InvalidSize;
+        }
+
+        void *memory = allocateMemory(allocator, sizeof(Window), alignof(Window));
+        if (memory == nullptr) {
+            return Result::OutOfMemory;
+        }
+        Window *window = new(memory) Window(allocator);
+
+#if defined(SURFER_NO_EXCEPTIONS)
+        const Result result = window->create(title, width, height, x, y);
+#else
+        Result result;
+        try {
+            result = window->create(title, width, height, x, y);
+        } catch (const std::bad_alloc &) {
+            result = Result::OutOfMemory;
+        }
+#endif
+        if (result != Result::Ok) {
+            destroyWindow(window);
+            return result;
+        }
+        *out = window;
+        return Result::Ok;
+    }
+
+    SURFER_DEF void Window::destroyWindow(const Window *window) {
+        if (window == nullptr) {
+            return;
+        }
+        // The callbacks live in the window, keep a copy to free its memory
+        const VkAllocationCallbacks callbacks = window->_allocationCallbacks;
+        const bool custom = window->_allocator != nullptr;
+        window->~Window();
+        freeMemory(custom ? &callbacks : nullptr, const_cast<Window *>(window));
+    }
+
+    SURFER_DEF void Window::pollEvents() {
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32_pollEvents();
+#elif defined(SURFER_PLATFORM_X11)
+        X11_pollEvents();
+#endif
+    }
+
+    SURFER_DEF bool Window::pollEvents(uint32_t maxEvents, uint32_t maxMicros) {
+#if defined(SURFER_PLATFORM_WIN32)
+        return Win32_pollEvents(maxEvents, maxMicros);
+#elif defined(SURFER_PLATFORM_X11)
+        return X11_processEvents(0, maxEvents, maxMicros);
+#endif
+    }
+
+    SURFER_DEF void Window::waitEvents() {
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32_waitEvents(INFINITE);
+#elif defined(SURFER_PLATFORM_X11)
+        X11_waitEvents(-1);
+#endif
+    }
+
+    SURFER_DEF void Window::waitEventsTimeout(double timeout) {
+        if (!_visible && _powerPolicy.pauseWhenHidden) {
+            waitEvents(); // nothing to redraw
+            return;
+        }
+        // Rounded up, a remaining fraction of a millisecond must not turn into a busy poll
+        const double milliseconds = timeout > 0.0 ? std::ceil(timeout * 1000.0) : 0.0;
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32_waitEvents(static_cast<DWORD>(milliseconds));
+#elif defined(SURFER_PLATFORM_X11)
+        X11_waitEvents(static_cast<int>(milliseconds));
+#endif
+    }
+
+    SURFER_DEF void Window::waitFrame() {
+        typedef std::chrono::steady_clock Clock;
+        // All polls below belong to one frame, their input is gathered together
+        beginPollInput();
+        _keepPollInput = true;
+        while (!_shouldClose) {
+            const Clock::time_point now = Clock::now();
+            if (!_visible && _powerPolicy.pauseWhenHidden) {
+                waitEvents();
+                _nextFrame = now;
+                break;
+            }
+
+            const double frameRate = _focused ? _powerPolicy.focusedFrameRate : _powerPolicy.unfocusedFrameRate;
+            if (frameRate <= 0.0 || now >= _nextFrame) {
+                if (frameRate > 0.0) {
+                    // Schedule from the previous deadline to keep a steady rate, unless we fell behind
+                    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(1.0 / frameRate));
+                    _nextFrame = (_nextFrame + period < now) ? now + period : _nextFrame + period;
+                }
+                pollEvents();
+                break;
+            }
+            waitEventsTimeout(std::chrono::duration<double>(_nextFrame - now).count());
+        }
+        _keepPollInput = false;
+    }
+
+    SURFER_DEF void Window::getCursorPosition(unsigned int &x, unsigned int &y) const {
+        x = _mouse_x;
+        y = _mouse_y;
+    }
+
+    SURFER_DEF void Window::getWindowPosition(unsigned int &x, unsigned int &y) const {
+        x = _x;
+        y = _y;
+    }
+
+    SURFER_DEF void Window::getWindowSize(unsigned int &width, unsigned int &height) const {
+        width = _width;
+        height = _height;
+    }
+
+    SURFER_DEF WindowState Window::getState() const {
+        uint32_t words[StateWordCount];
+        uint32_t before, after;
+        do {
+            before = _stateSequence.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < StateWordCount; i++) {
+                words[i] = _stateWords[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _stateSequence.load(std::memory_order_relaxed);
+        } while ((before & 1u) != 0u || before != after);
+
+        WindowState state;
+        std::memcpy(&state, words, sizeof(WindowState));
+        return state;
+    }
+
+#if defined(SURFER_ENABLE_METRICS)
+    SURFER_DEF Stats Window::getStats() const {
+        Stats stats = {};
+        stats.polls = _metrics.polls.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < EventTypeCount; i++) {
+            stats.events[i] = _metrics.events[i].load(std::memory_order_relaxed);
+        }
+        for (uint32_t i = 0; i < HistogramBucketCount; i++) {
+            stats.pollDuration[i] = _metrics.pollDuration[i].load(std::memory_order_relaxed);
+            stats.eventDuration[i] = _metrics.eventDuration[i].load(std::memory_order_relaxed);
+        }
+        stats.maxQueueDepth = _metrics.maxQueueDepth.load(std::memory_order_relaxed);
+        return stats;
+    }
+#endif
+
+    SURFER_DEF uint32_t Window::getKeyCharacter(KeyCode key) const {
+        uint32_t scancode = 0;
+        while (scancode < ScancodeCount && translateScancode(scancode) != key) {
+            scancode++;
+        }
+        if (scancode == ScancodeCount || key == KeyCode::UnsupportedKey) {
+            return 0;
+        }
+#if defined(SURFER_PLATFORM_WIN32)
+        return Win32_getKeyCharacter(scancode);
+#elif defined(SURFER_PLATFORM_X11)
+        return X11_getKeyCharacter(scancode);
+#endif
+    }
+
+    SURFER_DEF void Window::registerMouseMotionCallback(const MouseMotionCallback &callback) {
+        this->_mouseMotionCallback = callback;
+        updateEventMask();
+    }
+
+    SURFER_DEF void Window::registerMouseEnterExitCallback(const MouseEnterExitCallback &callback) {
+        this->_mouseEnterExitCallback = callback;
+        updateEventMask();
+    }
+
+    SURFER_DEF void Window::registerNativeKeyPressCallback(const NativeKeyPressCallback &callback) {
+        this->_nativeKeyPressCallback = callback;
+    }
+
+    SURFER_DEF void Window::registerNativeKeyReleaseCallback(const NativeKeyReleaseCallback &callback) {
+        this->_nativeKeyReleaseCallback = callback;
+    }
+
+    SURFER_DEF void Window::registerGamepadConnectionCallback(const GamepadConnectionCallback &callback) {
+        this->_gamepadConnectionCallback = callback;
+    }
+
+    SURFER_DEF void Window::enableGamepads() {
+#if defined(SURFER_GAMEPAD_EVDEV)
+        X11_enableGamepads();
+#endif
+    }
+
+    SURFER_DEF bool Window::getGamepadState(uint32_t index, GamepadState &state) const {
+        state = GamepadState();
+#if defined(SURFER_GAMEPAD_EVDEV)
+        if (index < MaxGamepads && X11_gamepads[index].fd >= 0) {
+            state = X11_gamepads[index].state;
+            applyGamepadDeadzone(state);
+        }
+#endif
+        return state.connected;
+    }
+
+#if defined(SURFER_PLATFORM_X11)
+    SURFER_DEF void Window::setClipboard(Selection selection, const std::string &mimeType, std::string data) {
+        X11_setSelection(selection, mimeType, std::move(data));
+    }
+
+    SURFER_DEF void Window::requestClipboard(Selection selection, const std::string &mimeType, const ClipboardCallback &callback) {
+        X11_requestSelection(selection, mimeType, callback);
+    }
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+    SURFER_DEF bool Window::addFileDescriptor(int fd, uint32_t events, const FileDescriptorCallback &callback) {
+        if (callback == nullptr) {
+            return false;
+        }
+        return X11_addSource(fd, events, callback, nullptr);
+    }
+
+    SURFER_DEF int Window::addTimer(double delay, double interval, const TimerCallback &callback) {
+        // Sources are told apart by their callback, an empty one would be taken for a file descriptor
+        if (callback == nullptr) {
+            return -1;
+        }
+        const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+
+        itimerspec spec = {};
+        spec.it_value = X11_toTimespec(delay > 0.0 ? delay : 1e-9); // zero would disarm the timer
+        spec.it_interval = X11_toTimespec(interval);
+        if (timerfd_settime(fd, 0, &spec, nullptr) < 0 || !X11_addSource(fd, EPOLLIN, nullptr, callback)) {
+            close(fd);
+            return -1;
+        }
+        X11_sources.back().oneShot = interval <= 0.0;
+        return fd;
+    }
+#endif
+
+    SURFER_DEF void Window::removeWaiter(EventWaiter *waiter) {
+        EventWaiter **lists[] = {&_keyWaiters, &_resizeWaiters, &_timerWaiters, &_resumingWaiters};
+        for (EventWaiter **list: lists) {
+            for (EventWaiter **link = list; *link != nullptr; link = &(*link)->next) {
+                if (*link == waiter) {
+                    *link = waiter->next;
+                    return;
+                }
+            }
+        }
+    }
+
+    SURFER_DEF void Window::enableMotionHistory(uint32_t capacity) {
+        _motionHistory.assign(capacity, MotionSample());
+        _motionCount = _motionHead = 0;
+        updateEventMask();
+    }
+
+    SURFER_DEF VkResult Window::createSurface(VkInstance instance, VkSurfaceKHR *surface) {
+#if defined(SURFER_PLATFORM_WIN32)
+        return Win32_CreateSurface(instance, surface);
+#elif defined(SURFER_PLATFORM_X11)
+        return X11_CreateSurface(instance, surface);
+#endif
+    }
+
+    SURFER_DEF Span<const char *> Window::getRequiredInstanceExtensions() {
+        static const char *const extensions[] = {
+            VK_KHR_SURFACE_EXTENSION_NAME,
+#if defined(SURFER_PLATFORM_WIN32)
+            VK_KHR_WIN32_SURFACE_EXTENSION_NAME
+#elif defined(SURFER_PLATFORM_X11)
+            VK_KHR_XLIB_SURFACE_EXTENSION_NAME
+#endif
+        };
+        return Span<const char *>(extensions, sizeof(extensions) / sizeof(extensions[0]));
+    }
+
+    SURFER_DEF bool Window::getPresentationSupport(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex) const {
+#if defined(SURFER_PLATFORM_WIN32)
+        return vkGetPhysicalDeviceWin32PresentationSupportKHR(physicalDevice, queueFamilyIndex) == VK_TRUE;
+#elif defined(SURFER_PLATFORM_X11)
+        const VisualID visual = XVisualIDFromVisual(DefaultVisual(X11_display, DefaultScreen(X11_display)));
+        return vkGetPhysicalDeviceXlibPresentationSupportKHR(physicalDevice, queueFamilyIndex, X11_display, visual) == VK_TRUE;
+#endif
+    }
+
+    SURFER_DEF VkResult Window::getSurfaceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                                       VkSurfaceCapabilitiesKHR *capabilities) {
+        SurfaceCacheEntry &entry = findSurfaceCacheEntry(physicalDevice, surface);
+        if (!entry.capabilitiesValid) {
+            const VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &entry.capabilities);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            entry.capabilitiesValid = true;
+        }
+        *capabilities = entry.capabilities;
+        return VK_SUCCESS;
+    }
+
+    SURFER_DEF VkResult Window::getSurfaceFormats(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                                  Span<VkSurfaceFormatKHR> *formats) {
+        SurfaceCacheEntry &entry = findSurfaceCacheEntry(physicalDevice, surface);
+        if (!entry.formatsValid) {
+            const VkResult result = enumerateSurface(vkGetPhysicalDeviceSurfaceFormatsKHR, physicalDevice, surface, entry.formats);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            entry.formatsValid = true;
+        }
+        *formats = Span<VkSurfaceFormatKHR>(entry.formats.data(), entry.formats.size());
+        return VK_SUCCESS;
+    }
+
+    SURFER_DEF VkResult Window::getSurfacePresentModes(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
+                                                       Span<VkPresentModeKHR> *presentModes) {
+        SurfaceCacheEntry &entry = findSurfaceCacheEntry(physicalDevice, surface);
+        if (!entry.presentModesValid) {
+            const VkResult result = enumerateSurface(vkGetPhysicalDeviceSurfacePresentModesKHR, physicalDevice, surface, entry.presentModes);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            entry.presentModesValid = true;
+        }
+        *presentModes = Span<VkPresentModeKHR>(entry.presentModes.data(), entry.presentModes.size());
+        return VK_SUCCESS;
+    }
+
+    SURFER_DEF void Window::invalidateSurfaceCache(VkSurfaceKHR surface) {
+        if (surface == VK_NULL_HANDLE) {
+            _surfaceCache.clear();
+            return;
+        }
+        _surfaceCache.erase(std::remove_if(_surfaceCache.begin(), _surfaceCache.end(),
+                                           [surface](const SurfaceCacheEntry &entry) { return entry.surface == surface; }),
+                            _surfaceCache.end());
+    }
+
+    SURFER_DEF Window::Window(const VkAllocationCallbacks *allocator)
+        : _allocationCallbacks(allocator != nullptr ? *allocator : VkAllocationCallbacks()),
+          _allocator(allocator != nullptr ? &_allocationCallbacks : nullptr)
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+          , X11_pollFds(Allocator<pollfd>(_allocator))
+#endif
+    {
+    }
+
+    SURFER_DEF Result Window::create(const std::string &title, const uint32_t width, const uint32_t height,
+                                     const int32_t x, const int32_t y) {
+        Result result = Result::Ok;
+#if defined(SURFER_PLATFORM_WIN32)
+        result = Win32_createWindow(title, width, height, x, y);
+#elif defined(SURFER_PLATFORM_X11)
+        result = X11_createWindow(title, width, height, x, y);
+#endif
+        if (result == Result::Ok) {
+            publishState();
+        }
+        return result;
+    }
+
+    SURFER_DEF Window::~Window() {
+        cancelWaiters();
+#if defined(SURFER_PLATFORM_WIN32)
+        Win32_destroyWindow();
+#elif defined(SURFER_PLATFORM_X11)
+        X11_destroyWindow();
+#endif
+    }
+
+    SURFER_DEF void Window::setKeyState(KeyCode key, bool down) {
+        if (key == KeyCode::UnsupportedKey) {
+            return;
+        }
+        const uint32_t index = static_cast<uint32_t>(key);
+        const uint64_t bit = uint64_t(1) << (index % 64u);
+        if (down && (_keys[index / 64u] & bit) == 0u) { // auto-repeat is not a new press
+            _pressedKeys[index / 64u] |= bit;
+        }
+        _keys[index / 64u] = down ? (_keys[index / 64u] | bit) : (_keys[index / 64u] & ~bit);
+    }
+
+    SURFER_DEF void Window::publishState() {
+        WindowState state = {};
+        state.width = _width;
+        state.height = _height;
+        state.x = _x;
+        state.y = _y;
+        state.mouseX = _mouse_x;
+        state.mouseY = _mouse_y;
+        state.wheel = _wheel;
+        state.focused = _focused;
+        state.visible = _visible;
+        state.shouldClose = _shouldClose;
+        std::memcpy(state.keys, _keys, sizeof(_keys));
+        std::memcpy(state.pressedKeys, _pressedKeys, sizeof(_pressedKeys));
+
+        uint32_t words[StateWordCount] = {};
+        std::memcpy(words, &state, sizeof(WindowState));
+
+        const uint32_t sequence = _stateSequence.load(std::memory_order_relaxed);
+        _stateSequence.store(sequence + 1u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t i = 0; i < StateWordCount; i++) {
+            _stateWords[i].store(words[i], std::memory_order_relaxed);
+        }
+        _stateSequence.store(sequence + 2u, std::memory_order_release);
+    }
+
+    SURFER_DEF Window::SurfaceCacheEntry &Window::findSurfaceCacheEntry(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+        for (SurfaceCacheEntry &entry: _surfaceCache) {
+            if (entry.physicalDevice == physicalDevice && entry.surface == surface) {
+                return entry;
+            }
+        }
+        SurfaceCacheEntry entry = {};
+        entry.physicalDevice = physicalDevice;
+        entry.surface = surface;
+        entry.formats = Vector<VkSurfaceFormatKHR>(_allocator);
+        entry.presentModes = Vector<VkPresentModeKHR>(_allocator);
+        _surfaceCache.push_back(std::move(entry));
+        return _surfaceCache.back();
+    }
+
+    template<typename T>
+    SURFER_DEF VkResult Window::enumerateSurface(VkResult (VKAPI_PTR *query)(VkPhysicalDevice, VkSurfaceKHR, uint32_t *, T *),
+                                                 VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, Vector<T> &out) {
+        VkResult result;
+        do {
+            uint32_t count = 0;
+            result = query(physicalDevice, surface, &count, nullptr);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+            out.resize(count);
+            result = query(physicalDevice, surface, &count, out.data());
+            out.resize(count);
+        } while (result == VK_INCOMPLETE); // the list changed between the calls
+        return result;
+    }
+
+    SURFER_DEF void Window::invalidateSurfaceExtent() {
+        for (SurfaceCacheEntry &entry: _surfaceCache) {
+            entry.capabilitiesValid = false;
+        }
+    }
+
+    SURFER_DEF void Window::invalidateSurfaceMonitor() {
+        for (SurfaceCacheEntry &entry: _surfaceCache) {
+            entry.capabilitiesValid = entry.formatsValid = entry.presentModesValid = false;
+        }
+    }
+
+#if defined(SURFER_ENABLE_METRICS)
+    SURFER_DEF void Window::metricsIncrement(std::atomic<uint64_t> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+    }
+
+    SURFER_DEF void Window::metricsRecordDuration(std::atomic<uint64_t> (&histogram)[HistogramBucketCount],
+                                                  MetricsClock::time_point start) {
+        uint64_t micros = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(MetricsClock::now() - start).count());
+        uint32_t bucket = 0;
+        while (micros != 0u && bucket < HistogramBucketCount - 1u) {
+            micros >>= 1u;
+            bucket++;
+        }
+        metricsIncrement(histogram[bucket]);
+    }
+
+    SURFER_DEF void Window::metricsRecordPoll(MetricsClock::time_point start, uint32_t queueDepth) {
+        metricsIncrement(_metrics.polls);
+        metricsRecordDuration(_metrics.pollDuration, start);
+        if (queueDepth > _metrics.maxQueueDepth.load(std::memory_order_relaxed)) {
+            _metrics.maxQueueDepth.store(queueDepth, std::memory_order_relaxed);
+        }
+    }
+
+    SURFER_DEF void Window::metricsRecordEvent(EventType type, MetricsClock::time_point start) {
+        metricsIncrement(_metrics.events[static_cast<uint32_t>(type)]);
+        metricsRecordDuration(_metrics.eventDuration, start);
+    }
+#endif
+
+    SURFER_DEF KeyCode Window::translateScancode(uint32_t scancode) {
+        typedef KeyCode K;
+        static constexpr KeyCode table[ScancodeCount] = {
+            K::UnsupportedKey, K::Esc, K::Num1, K::Num2, K::Num3, K::Num4, K::Num5, K::Num6, // 0-7
+            K::Num7, K::Num8, K::Num9, K::Num0, K::Minus, K::Equal, K::BackSpace, K::Tab, // 8-15
+            K::KeyQ, K::KeyW, K::KeyE, K::KeyR, K::KeyT, K::KeyY, K::KeyU, K::KeyI, // 16-23
+            K::KeyO, K::KeyP, K::BracketLeft, K::BracketRight, K::Enter, K::LeftControl, K::KeyA, K::KeyS, // 24-31
+            K::KeyD, K::KeyF, K::KeyG, K::KeyH, K::KeyJ, K::KeyK, K::KeyL, K::Semicolon, // 32-39
+            K::Apostrophe, K::Grave, K::LeftShift, K::Backslash, K::KeyZ, K::KeyX, K::KeyC, K::KeyV, // 40-47
+            K::KeyB, K::KeyN, K::KeyM, K::Comma, K::Period, K::Slash, K::RightShift, K::NumpadMultiply, // 48-55
+            K::LeftAlt, K::Space, K::CapsLock, K::F1, K::F2, K::F3, K::F4, K::F5, // 56-63
+            K::F6, K::F7, K::F8, K::F9, K::F10, K::NumLock, K::ScrollLock, K::Numpad7, // 64-71
+            K::Numpad8, K::Numpad9, K::NumpadSubtract, K::Numpad4, K::Numpad5, K::Numpad6, K::NumpadAdd, K::Numpad1, // 72-79
+            K::Numpad2, K::Numpad3, K::Numpad0, K::NumpadDecimal, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::F11, // 80-87
+            K::F12, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, // 88-95
+            K::NumpadEnter, K::RightControl, K::NumpadDivide, K::PrtSc, K::RightAlt, K::UnsupportedKey, K::Home, K::ArrowUp, // 96-103
+            K::PageUp, K::ArrowLeft, K::ArrowRight, K::End, K::ArrowDown, K::PageDown, K::Insert, K::Delete, // 104-111
+            K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::NumpadEqual, K::UnsupportedKey, K::Pause, // 112-119
+            K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::UnsupportedKey, K::SuperLeft, K::SuperRight // 120-126
+        };
+        return scancode < ScancodeCount ? table[scancode] : KeyCode::UnsupportedKey;
+    }
+
+    SURFER_DEF void Window::pushWaiter(EventWaiter *&list, EventWaiter *waiter) {
+        waiter->next = list;
+        list = waiter;
+    }
+
+    SURFER_DEF EventWaiter *Window::popResumingWaiter() {
+        EventWaiter *waiter = _resumingWaiters;
+        if (waiter != nullptr) {
+            _resumingWaiters = waiter->next;
+            waiter->next = nullptr;
+        }
+        return waiter;
+    }
+
+    SURFER_DEF void Window::cancelWaiters() {
+        EventWaiter **lists[] = {&_keyWaiters, &_resizeWaiters, &_timerWaiters, &_resumingWaiters};
+        for (EventWaiter **list: lists) {
+            // Unlink first, a cancelled waiter may be destroyed
+            while (EventWaiter *waiter = *list) {
+                *list = waiter->next;
+                if (waiter->cancel != nullptr) {
+                    waiter->cancel(waiter);
+                }
+            }
+        }
+    }
+
+    SURFER_DEF void Window::resumeKeyWaiters(KeyCode key) {
+        EventWaiter *const outer = _resumingWaiters; // set if called from within a resumed waiter
+        _resumingWaiters = _keyWaiters;
+        _keyWaiters = nullptr;
+        while (EventWaiter *waiter = popResumingWaiter()) {
+            waiter->key = key;
+            waiter->resume(waiter);
+        }
+        _resumingWaiters = outer;
+    }
+
+    SURFER_DEF void Window::resumeResizeWaiters(uint32_t width, uint32_t height) {
+        EventWaiter *const outer = _resumingWaiters;
+        _resumingWaiters = _resizeWaiters;
+        _resizeWaiters = nullptr;
+        while (EventWaiter *waiter = popResumingWaiter()) {
+            waiter->width = width;
+            waiter->height = height;
+            waiter->resume(waiter);
+        }
+        _resumingWaiters = outer;
+    }
+
+    SURFER_DEF void Window::resumeTimerWaiters() {
+        if (_shortcutMap != nullptr) {
+            _shortcutMap->update();
+        }
+        if (_timerWaiters == nullptr) {
+            return;
+        }
+        // Unlink the expired ones first, resuming may add new timers
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        EventWaiter *const outer = _resumingWaiters;
+        _resumingWaiters = nullptr;
+        for (EventWaiter **link = &_timerWaiters; *link != nullptr;) {
+            EventWaiter *waiter = *link;
+            if (waiter->deadline <= now) {
+                *link = waiter->next;
+                pushWaiter(_resumingWaiters, waiter);
+            } else {
+                link = &waiter->next;
+            }
+        }
+        while (EventWaiter *waiter = popResumingWaiter()) {
+            waiter->resume(waiter);
+        }
+        _resumingWaiters = outer;
+    }
+
+    SURFER_DEF int Window::clampToTimerWaiters(int timeout) const {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (const EventWaiter *waiter = _timerWaiters; waiter != nullptr; waiter = waiter->next) {
+            const int64_t remaining = waiter->deadline <= now ? 0 :
+                std::chrono::duration_cast<std::chrono::milliseconds>(waiter->deadline - now).count() + 1;
+            if (timeout < 0 || remaining < timeout) {
+                timeout = static_cast<int>(remaining);
+            }
+        }
+        return _shortcutMap != nullptr ? _shortcutMap->clampTimeout(timeout) : timeout;
+    }
+
+    SURFER_DEF ModifierFlags Window::getModifiers() const {
+        const struct {
+            KeyCode left, right;
+            ModifierFlagBits flag;
+        } modifiers[] = {
+            {KeyCode::LeftShift, KeyCode::RightShift, ModifierShift},
+            {KeyCode::LeftControl, KeyCode::RightControl, ModifierControl},
+            {KeyCode::LeftAlt, KeyCode::RightAlt, ModifierAlt},
+            {KeyCode::SuperLeft, KeyCode::SuperRight, ModifierSuper},
+        };
+
+        ModifierFlags flags = 0u;
+        for (const auto &modifier: modifiers) {
+            const uint32_t left = static_cast<uint32_t>(modifier.left);
+            const uint32_t right = static_cast<uint32_t>(modifier.right);
+            if (((_keys[left / 64u] >> (left % 64u)) & 1u) != 0u || ((_keys[right / 64u] >> (right % 64u)) & 1u) != 0u) {
+                flags |= modifier.flag;
+            }
+        }
+        return flags;
+    }
+
+    SURFER_DEF void Window::dispatchShortcut(KeyCode key) {
+        if (_shortcutMap != nullptr) {
+            _shortcutMap->onKeyPress(getModifiers(), key);
+        }
+    }
+
+    SURFER_DEF void Window::recordMotionSample(int32_t x, int32_t y, uint64_t time) {
+        const size_t capacity = _motionHistory.size();
+        if (capacity == 0) {
+            return;
+        }
+        MotionSample &sample = _motionHistory[(_motionHead + _motionCount) % capacity];
+        sample.x = x;
+        sample.y = y;
+        sample.time = time;
+        if (_motionCount < capacity) {
+            _motionCount++;
+        } else {
+            _motionHead = (_motionHead + 1) % capacity; // overwrote the oldest
+        }
+    }
+
+    SURFER_DEF bool Window::withinBudget(uint32_t processed, uint32_t maxEvents, uint32_t maxMicros,
+                                         std::chrono::steady_clock::time_point start) {
+        if (processed >= maxEvents) {
+            return false;
+        }
+        return maxMicros == UINT32_MAX ||
+               std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() <
+               static_cast<int64_t>(maxMicros);
+    }
+
+    SURFER_DEF void Window::finishMotionHistory() {
+        if (_motionHead != 0) {
+            std::rotate(_motionHistory.begin(), _motionHistory.begin() + static_cast<std::ptrdiff_t>(_motionHead),
+                        _motionHistory.end());
+            _motionHead = 0;
+        }
+    }
+
+    SURFER_DEF void Window::setVisibility(bool visible, bool minimized) {
+        _minimized = minimized;
+        if (visible != _visible) {
+            _visible = visible;
+            if (_occlusionCallback != nullptr) {
+                _occlusionCallback(visible);
+            }
+        }
+    }
+
+    SURFER_DEF void Window::updateEventMask() {
+#if defined(SURFER_PLATFORM_X11)
+        X11_updateEventMask();
+#endif
+    }
+
+    SURFER_DEF bool Window::dispatchKeyRepeat(KeyCode key) {
+        switch (_keyRepeatMode) {
+            case KeyRepeatMode::Press: return true;
+            case KeyRepeatMode::Separate:
+                if (_keyRepeatCallback != nullptr) {
+                    _keyRepeatCallback(key);
+                }
+                return false;
+            case KeyRepeatMode::Suppress: return false;
+        }
+        return true;
+    }
+
+    SURFER_DEF void Window::beginPollInput() {
+        if (_keepPollInput) {
+            return;
+        }
+        _textInput.clear();
+        _textDispatched = 0;
+        _motionCount = _motionHead = 0;
+        _wheel = 0.0f;
+        std::memset(_pressedKeys, 0, sizeof(_pressedKeys));
+    }
+
+    SURFER_DEF void Window::dispatchTextInput() {
+        SURFER_TRACE_ZONE("CharacterInputCallback");
+        // Within a frame only the text of the latest poll is new
+        if (_characterInputCallback != nullptr && _textInput.size() > _textDispatched) {
+            _characterInputCallback(_textInput.c_str() + _textDispatched);
+        }
+        _textDispatched = _textInput.size();
+    }
+
+    SURFER_DEF void Window::applyGamepadDeadzone(GamepadState &state) const {
+        const float deadzone = _gamepadDeadzone;
+        const uint32_t sticks[2][2] = {
+            {static_cast<uint32_t>(GamepadAxis::LeftX), static_cast<uint32_t>(GamepadAxis::LeftY)},
+            {static_cast<uint32_t>(GamepadAxis::RightX), static_cast<uint32_t>(GamepadAxis::RightY)}
+        };
+
+        // Radial deadzone for sticks, rescaled so the output starts at zero on the deadzone edge
+        for (const auto &stick: sticks) {
+            float &x = state.axes[stick[0]];
+            float &y = state.axes[stick[1]];
+            const float magnitude = std::sqrt(x * x + y * y);
+            if (magnitude <= deadzone) {
+                x = y = 0.0f;
+                continue;
+            }
+            const float scale = std::fmin(1.0f, (magnitude - deadzone) / (1.0f - deadzone)) / magnitude;
+            x *= scale;
+            y *= scale;
+        }
+
+        for (uint32_t axis = static_cast<uint32_t>(GamepadAxis::LeftTrigger); axis < GamepadAxisCount; axis++) {
+            float &value = state.axes[axis];
+            value = value <= deadzone ? 0.0f : (value - deadzone) / (1.0f - deadzone);
+        }
+    }
+
+#if defined(SURFER_PLATFORM_WIN32)
+    SURFER_DEF Result Window::Win32_createWindow(const std::string &title, const uint32_t width,
+                                                 const uint32_t height, const int32_t x, const int32_t y) {
+        _width = width;
+        _height = height;
+        _x = x;
+        _y = y;
+        _title.assign(title.data(), title.size());
+
+        SetProcessDPIAware();
+
+        Win32_hInstance = GetModuleHandle(nullptr);
+
+        WNDCLASSEX wc = {};
+        wc.cbSize = sizeof(WNDCLASSEX);
+        wc.style = CS_HREDRAW | CS_VREDRAW;
+        wc.lpfnWndProc = this->WndProc;
+        wc.hInstance = Win32_hInstance;
+        wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+        wc.lpszClassName = title.c_str();
+
+        if (!RegisterClassEx(&wc)) {
+            return Result::ClassRegistrationFailed;
+        }
+
+        // Calculate window rect to account for borders and title bar
+        RECT windowRect = {0, 0, static_cast<LONG>(width), static_cast<LONG>(height)};
+        AdjustWindowRectEx(&windowRect, WS_OVERLAPPEDWINDOW, FALSE, 0);
+        int adjustedWidth = windowRect.right - windowRect.left;
+        int adjustedHeight = windowRect.bottom - windowRect.top;
+
+        Win32_hWnd = CreateWindowEx(
+            0,
+            wc.lpszClassName,
+            title.c_str(),
+            WS_OVERLAPPEDWINDOW,
+            x, y,
+            adjustedWidth, adjustedHeight, // Use adjusted dimensions
+            nullptr,
+            nullptr,
+            wc.hInstance,
+            this);
+
+        if (!Win32_hWnd) {
+            return Result::WindowCreationFailed;
+        }
+
+        SetWindowLongPtr(Win32_hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        ShowWindow(Win32_hWnd, SW_SHOW);
+        UpdateWindow(Win32_hWnd);
+        return Result::Ok;
+    }
+
+    SURFER_DEF void Window::Win32_destroyWindow() {
+        // A null handle would pump the messages of every window on the thread
+        MSG msg;
+        while (Win32_hWnd && PeekMessage(&msg, Win32_hWnd, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        if (Win32_hWnd) {
+            // Don't destroy if already being destroyed
+            if (IsWindow(Win32_hWnd)) {
+                // This triggers WM_DESTROY
+                DestroyWindow(Win32_hWnd);
+            }
+            Win32_hWnd = nullptr;
+        }
+
+        // Only unregister if we're the last window using this class
+        WNDCLASSEX wc = {};
+        wc.cbSize = sizeof(WNDCLASSEX);
+        if (GetClassInfoEx(GetModuleHandle(nullptr), _title.c_str(), &wc)) {
+            UnregisterClass(_title.c_str(), GetModuleHandle(nullptr));
+        }
+    }
+
+    SURFER_DEF VkResult Window::Win32_CreateSurface(VkInstance instance, VkSurfaceKHR *surface) const {
+        VkWin32SurfaceCreateInfoKHR surfaceCreateInfo = {};
+        surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+        surfaceCreateInfo.hwnd = Win32_hWnd;
+        surfaceCreateInfo.hinstance = Win32_hInstance;
+
+        return vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, _allocator, surface);
+    }
+
+    SURFER_DEF bool Window::Win32_pollEvents(uint32_t maxEvents, uint32_t maxMicros) {
+        beginPollInput();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint32_t processed = 0;
+
+#if defined(SURFER_ENABLE_METRICS)
+        const MetricsClock::time_point pollStart = MetricsClock::now();
+        uint32_t queueDepth = 0; // Win32 has no queue length query, count what this poll drained
+#endif
+
+        MSG msg;
+        auto dispatch = [&]() {
+            processed++;
+#if defined(SURFER_ENABLE_METRICS)
+            const MetricsClock::time_point eventStart = MetricsClock::now();
+            queueDepth++;
+#endif
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+#if defined(SURFER_ENABLE_METRICS)
+            metricsRecordEvent(Win32_eventType(msg.message), eventStart);
+#endif
+        };
+
+        // WM_CLOSE and WM_SIZE are sent and dispatched by PeekMessage itself, but what leads to them is posted:
+        // clicks on the caption buttons and frame (WM_NCLBUTTONDOWN) and system commands (e.g. close from the
+        // taskbar). A budgeted poll takes those out of the queue first, like X11_processPriorityEvents.
+        if (maxEvents != UINT32_MAX || maxMicros != UINT32_MAX) {
+            const UINT priorityMessages[] = {WM_SYSCOMMAND, WM_NCLBUTTONDOWN};
+            for (UINT message: priorityMessages) {
+                while (PeekMessage(&msg, Win32_hWnd, message, message, PM_REMOVE)) {
+                    dispatch();
+                }
+            }
+        }
+
+        while (withinBudget(processed, maxEvents, maxMicros, start) &&
+               PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+            dispatch();
+        }
+
+        MSG next;
+        const bool pending = PeekMessage(&next, nullptr, 0, 0, PM_NOREMOVE) != 0;
+
+        dispatchTextInput();
+        finishMotionHistory();
+        resumeTimerWaiters();
+#if defined(SURFER_ENABLE_METRICS)
+        metricsRecordPoll(pollStart, queueDepth);
+#endif
+        publishState();
+        return pending;
+    }
+
+#if defined(SURFER_ENABLE_METRICS)
+    SURFER_DEF EventType Window::Win32_eventType(UINT message) {
+        switch (message) {
+            case WM_KEYDOWN:
+            case WM_KEYUP:
+            case WM_SYSKEYDOWN:
+            case WM_SYSKEYUP:
+            case WM_CHAR: return EventType::Key;
+            case WM_LBUTTONDOWN:
+            case WM_LBUTTONUP:
+            case WM_RBUTTONDOWN:
+            case WM_RBUTTONUP:
+            case WM_MBUTTONDOWN:
+            case WM_MBUTTONUP:
+            case WM_MOUSEWHEEL: return EventType::MouseButton;
+            case WM_MOUSEMOVE: return EventType::MouseMotion;
+            case WM_MOUSELEAVE: return EventType::MouseCrossing;
+            case WM_SETFOCUS:
+            case WM_KILLFOCUS: return EventType::Focus;
+            case WM_SIZE:
+            case WM_MOVE: return EventType::Configure;
+            case WM_PAINT: return EventType::Redraw;
+            case WM_CLOSE: return EventType::WindowManager;
+            default: return EventType::Other;
+        }
+    }
+#endif
+
+    SURFER_DEF void Window::Win32_waitEvents(DWORD timeout) {
+        const int clamped = clampToTimerWaiters(timeout == INFINITE ? -1 : static_cast<int>(timeout));
+        timeout = clamped < 0 ? INFINITE : static_cast<DWORD>(clamped);
+        // Also wake for input that an earlier PeekMessage already saw, a budgeted poll leaves it queued
+        MsgWaitForMultipleObjectsEx(0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        Win32_pollEvents();
+    }
+
+    SURFER_DEF LRESULT CALLBACK Window::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+        Window *window = reinterpret_cast<Window *>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+
+        switch (uMsg) {
+            case WM_CLOSE:
+                if (window) {
+                    window->Win32_onClose();
+                }
+                return 0;
+            case WM_DESTROY: {
+                SetWindowLongPtr(hWnd, GWLP_USERDATA, 0); // Clear user data
+                PostQuitMessage(0);
+                if (window) {
+                    window->Win32_onDestroy();
+                }
+                return 0;
+            }
+            case WM_PAINT:
+                ValidateRect(hWnd, NULL);
+                return 0;
+            case WM_KEYDOWN:
+                if (window) {
+                    window->Win32_onKeyDown(wParam, lParam);
+                }
+                return 0;
+            case WM_KEYUP:
+                if (window) {
+                    window->Win32_onKeyUp(wParam, lParam);
+                }
+                return 0;
+            case WM_LBUTTONDOWN: {
+                if (window) {
+                    window->Win32_onButtonPress(WM_LBUTTONDOWN);
+                }
+                return 0;
+            }
+            case WM_RBUTTONDOWN: {
+                if (window) {
+                    window->Win32_onButtonPress(WM_RBUTTONDOWN);
+                }
+                return 0;
+            }
+            case WM_MBUTTONDOWN: {
+                if (window) {
+                    window->Win32_onButtonPress(WM_MBUTTONDOWN);
+                }
+                return 0;
+            }
+            case WM_LBUTTONUP: {
+                if (window) {
+                    window->Win32_onButtonRelease(WM_LBUTTONUP);
+                }
+                return 0;
+            }
+            case WM_RBUTTONUP: {
+                if (window) {
+                    window->Win32_onButtonRelease(WM_RBUTTONUP);
+                }
+                return 0;
+            }
+            case WM_MBUTTONUP: {
+                if (window) {
+                    window->Win32_onButtonRelease(WM_MBUTTONUP);
+                }
+                return 0;
+            }
+            case WM_MOUSEWHEEL: {
+                if (window) {
+                    window->_wheel += static_cast<float>(GET_WHEEL_DELTA_WPARAM(wParam)) / WHEEL_DELTA;
+                }
+                return 0;
+            }
+            case WM_MOUSEMOVE: {
+                int xPos = GET_X_LPARAM(lParam);
+                int yPos = GET_Y_LPARAM(lParam);
+                if (window) {
+                    window->recordMotionSample(xPos, yPos, static_cast<uint64_t>(GetMessageTime()));
+                    window->Win32_onMouseMove(xPos, yPos);
+
+                    TRACKMOUSEEVENT tme = {};
+                    tme.cbSize = sizeof(tme);
+                    tme.dwFlags = TME_LEAVE;
+                    tme.hwndTrack = window->Win32_hWnd;
+                    TrackMouseEvent(&tme);
+
+                    if (!window->_mouseEntered) {
+                        window->Win32_onMouseEnter();
+                    }
+                }
+                return 0;
+            }
+            case WM_MOUSELEAVE: {
+                if (window) {
+                    window->Win32_onMouseLeave();
+                }
+                return 0;
+            }
+            case WM_SIZE: // size changed
+                if (window) {
+                    window->setVisibility(wParam != SIZE_MINIMIZED, wParam == SIZE_MINIMIZED);
+                }
+                if (window && wParam != SIZE_MINIMIZED) {
+                    if ((window->Win32_resizing) || ((wParam == SIZE_MAXIMIZED) || (wParam == SIZE_RESTORED))) {
+                        uint32_t width = LOWORD(lParam);
+                        uint32_t height = HIWORD(lParam);
+                        window->Win32_onResize(width, height);
+                    }
+                }
+                return 0;
+            case WM_ENTERSIZEMOVE: // resizing started
+                window->Win32_resizing = true;
+                return 0;
+            case WM_EXITSIZEMOVE: // resizing stopped
+                window->Win32_resizing = false;
+                return 0;
+            case WM_DISPLAYCHANGE: // monitor configuration changed
+                if (window) {
+                    window->invalidateSurfaceMonitor();
+                }
+                return 0;
+            case WM_DPICHANGED:
+                if (window) {
+                    window->Win32_onDpiChange(hWnd, wParam, lParam);
+                }
+                return 0;
+            case WM_MOVE: {
+                if (window) {
+                    window->Win32_onMove(lParam);
+                }
+                return 0;
+            }
+            case WM_SETFOCUS: {
+                if (window) {
+                    window->Win32_onFocusIn();
+                }
+            }
+            case WM_KILLFOCUS: {
+                if (window && !window->shouldClose()) {
+                    window->Win32_onFocusOut();
+                }
+            }
+            case WM_CHAR: {
+                if (window) {
+                    window->Win32_onCharInput(wParam);
+                }
+                return 0;
+            }
+            case WM_SYSCHAR:
+                return 0;
+            default:
+                return DefWindowProc(hWnd, uMsg, wParam, lParam);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onMouseEnter() {
+        _mouseEntered = true;
+        if (_mouseEnterExitCallback != nullptr) {
+            _mouseEnterExitCallback(true);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onMouseLeave() {
+        _mouseEntered = false;
+        if (_mouseEnterExitCallback != nullptr) {
+            _mouseEnterExitCallback(false);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onCharInput(WPARAM wParam) {
+        static wchar_t high_surrogate = 0;
+
+        wchar_t wc = static_cast<wchar_t>(wParam);
+
+        uint32_t codepoint = 0;
+
+        // Handle surrogate pairs
+        if (wc >= 0xD800 && wc <= 0xDBFF) {
+            high_surrogate = wc;
+            return;
+        }
+        else if (wc >= 0xDC00 && wc <= 0xDFFF && high_surrogate) {
+            codepoint = 0x10000 + ((high_surrogate - 0xD800) << 10) + (wc - 0xDC00);
+            high_surrogate = 0;
+        }
+        else {
+            codepoint = static_cast<uint32_t>(wc);
+            high_surrogate = 0;
+        }
+
+        // Filter control characters
+        if (!(codepoint >= 0x20 || codepoint == '\n' || codepoint == '\t'))
+            return;
+
+        // Convert codepoint to UTF-8
+        char utf8[5] = {0}; // max 4 bytes + null terminator
+        if (codepoint <= 0x7F) {
+            utf8[0] = static_cast<char>(codepoint);
+        }
+        else if (codepoint <= 0x7FF) {
+            utf8[0] = static_cast<char>(0xC0 | (codepoint >> 6));
+            utf8[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else if (codepoint <= 0xFFFF) {
+            utf8[0] = static_cast<char>(0xE0 | (codepoint >> 12));
+            utf8[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            utf8[2] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else { // <= 0x10FFFF
+            utf8[0] = static_cast<char>(0xF0 | (codepoint >> 18));
+            utf8[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            utf8[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            utf8[3] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+
+        // Append to the text gathered during this poll
+        _textInput.append(utf8);
+    }
+
+    SURFER_DEF KeyCode Window::Win32_translateKey(WPARAM key, LPARAM lParam) {
+        if (_keyTranslationMode == KeyTranslationMode::Scancode) {
+            return translateScancode(Win32_scancodeToEvdev(static_cast<uint32_t>((lParam >> 16) & 0xFF), (lParam & (1 << 24)) != 0));
+        }
+        return Win32_translateKeyCode(key);
+    }
+
+    SURFER_DEF uint32_t Window::Win32_scancodeToEvdev(uint32_t scancode, bool extended) {
+        if (!extended) {
+            return scancode == 0x45 ? 119u : scancode; // Pause arrives as 0x45, NumLock as extended 0x45
+        }
+        switch (scancode) {
+            case 0x1C: return 96u; // NumpadEnter
+            case 0x1D: return 97u; // RightControl
+            case 0x35: return 98u; // NumpadDivide
+            case 0x37: return 99u; // PrtSc
+            case 0x38: return 100u; // RightAlt
+            case 0x45: return 69u; // NumLock
+            case 0x47: return 102u; // Home
+            case 0x48: return 103u; // ArrowUp
+            case 0x49: return 104u; // PageUp
+            case 0x4B: return 105u; // ArrowLeft
+            case 0x4D: return 106u; // ArrowRight
+            case 0x4F: return 107u; // End
+            case 0x50: return 108u; // ArrowDown
+            case 0x51: return 109u; // PageDown
+            case 0x52: return 110u; // Insert
+            case 0x53: return 111u; // Delete
+            case 0x5B: return 125u; // SuperLeft
+            case 0x5C: return 126u; // SuperRight
+            default: return 0u;
+        }
+    }
+
+    SURFER_DEF uint32_t Window::Win32_getKeyCharacter(uint32_t evdev) {
+        // Reverse of Win32_scancodeToEvdev
+        uint32_t scancode = evdev;
+        bool extended = false;
+        if (evdev == 119u) {
+            scancode = 0x45;
+        } else if (evdev == 69u || evdev >= 96u) {
+            for (uint32_t candidate = 0; candidate < 0x80; candidate++) {
+                if (Win32_scancodeToEvdev(candidate, true) == evdev) {
+                    scancode = candidate;
+                    extended = true;
+                    break;
+                }
+            }
+        }
+
+        const UINT vk = MapVirtualKeyW(scancode | (extended ? 0xE000u : 0u), MAPVK_VSC_TO_VK_EX);
+        BYTE keyboardState[256] = {};
+        WCHAR buffer[4];
+        // Flag 4 keeps dead key state of the keyboard untouched
+        const int count = ToUnicode(vk, scancode, keyboardState, buffer, 4, 4);
+        return count == 1 ? static_cast<uint32_t>(buffer[0]) : 0u;
+    }
+
+    SURFER_DEF void Window::Win32_onKeyDown(WPARAM key, LPARAM lParam) {
+        const KeyCode translatedKeyCode = Win32_translateKey(key, lParam);
+        setKeyState(translatedKeyCode, true);
+
+        // Bit 30 holds the previous key state, set for auto-repeat
+        const bool repeat = (lParam & (1 << 30)) != 0;
+        if (repeat && !dispatchKeyRepeat(translatedKeyCode)) {
+            return;
+        }
+
+        if (_keyPressCallback != nullptr) {
+            _keyPressCallback(translatedKeyCode);
+        }
+
+        resumeKeyWaiters(translatedKeyCode);
+        dispatchShortcut(translatedKeyCode);
+
+        if (_nativeKeyPressCallback != nullptr) {
+            _nativeKeyPressCallback(key);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onKeyUp(WPARAM key, LPARAM lParam) {
+        const KeyCode translatedKeyCode = Win32_translateKey(key, lParam);
+        setKeyState(translatedKeyCode, false);
+
+        if (_keyReleaseCallback != nullptr) {
+            _keyReleaseCallback(translatedKeyCode);
+        }
+
+        if (_nativeKeyReleaseCallback != nullptr) {
+            _nativeKeyReleaseCallback(key);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onClose() {
+        // Set should close first
+        _shouldClose = true;
+
+        // Wait for any pending messages
+        MSG msg;
+        while (PeekMessage(&msg, Win32_hWnd, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onDestroy() {
+        if (_closeCallback != nullptr)
+            _closeCallback();
+    }
+
+    SURFER_DEF void Window::Win32_onMouseMove(int xPos, int yPos) {
+        if (_mouse_x != xPos || _mouse_y != yPos) {
+            // save the internal state
+            _mouse_x = xPos;
+            _mouse_y = yPos;
+
+            if (_mouseMotionCallback != nullptr) {
+                _mouseMotionCallback(xPos, yPos);
+            }
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onButtonPress(UINT button) {
+        const KeyCode key = Win32_translateButton(button);
+        setKeyState(key, true);
+
+        if (_keyPressCallback != nullptr) {
+            _keyPressCallback(key);
+        }
+
+        resumeKeyWaiters(key);
+        dispatchShortcut(key);
+    }
+
+    SURFER_DEF void Window::Win32_onButtonRelease(UINT button) {
+        const KeyCode key = Win32_translateButton(button);
+        setKeyState(key, false);
+
+        if (_keyReleaseCallback != nullptr) {
+            _keyReleaseCallback(key);
+        }
+    }
+
+    SURFER_DEF KeyCode Window::Win32_translateButton(UINT button) {
+        switch (button) {
+            case WM_LBUTTONDOWN:
+            case WM_LBUTTONUP: return KeyCode::MouseLeft;
+            case WM_RBUTTONDOWN:
+            case WM_RBUTTONUP: return KeyCode::MouseRight;
+            case WM_MBUTTONDOWN:
+            case WM_MBUTTONUP: return KeyCode::MouseMiddle;
+            default: return KeyCode::UnsupportedKey;
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onResize(uint32_t width, uint32_t height) {
+        _width = width;
+        _height = height;
+        invalidateSurfaceExtent();
+
+        if (_resizeCallback != nullptr) {
+            _resizeCallback(width, height);
+        }
+
+        resumeResizeWaiters(width, height);
+    }
+
+    SURFER_DEF void Window::Win32_onMove(LPARAM lParam) {
+        int x = LOWORD(lParam);
+        int y = HIWORD(lParam);
+
+        if (x != _x || y != _y) {
+            _x = x;
+            _y = y;
 
-            switch (uMsg) {
-                case WM_CLOSE:
-                    if (window) {
-                        window->Win32_onClose();
-                    }
-                    return 0;
-                case WM_DESTROY: {
-                    SetWindowLongPtr(hWnd, GWLP_USERDATA, 0); // Clear user data
-                    PostQuitMessage(0);
-                    if (window) {
-                        window->Win32_onDestroy();
-                    }
-                    return 0;
-                }
-                case WM_PAINT:
-                    ValidateRect(hWnd, NULL);
-                    return 0;
-                case WM_KEYDOWN:
-                    if (window) {
-                        window->Win32_onKeyDown(wParam);
-                    }
-                    return 0;
-                case WM_KEYUP:
-                    if (window) {
-                        window->Win32_onKeyUp(wParam);
-                    }
-                    return 0;
-                case WM_LBUTTONDOWN: {
-                    if (window) {
-                        window->Win32_onButtonPress(WM_LBUTTONDOWN);
-                    }
-                    return 0;
-                }
-                case WM_RBUTTONDOWN: {
-                    if (window) {
-                        window->Win32_onButtonPress(WM_RBUTTONDOWN);
-                    }
-                    return 0;
-                }
-                case WM_MBUTTONDOWN: {
-                    if (window) {
-                        window->Win32_onButtonPress(WM_MBUTTONDOWN);
-                    }
-                    return 0;
-                }
-                case WM_LBUTTONUP: {
-                    if (window) {
-                        window->Win32_onButtonRelease(WM_LBUTTONUP);
-                    }
-                    return 0;
+            if (_moveCallback != nullptr) {
+                _moveCallback(x, y);
+            }
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onDpiChange(HWND hWnd, WPARAM wParam, LPARAM lParam) {
+        UINT dpi = HIWORD(wParam);
+        RECT *const pRect = reinterpret_cast<RECT *>(lParam);
+
+        if (pRect) {
+            SetWindowPos(hWnd,
+                         nullptr,
+                         pRect->left,
+                         pRect->top,
+                         pRect->right - pRect->left,
+                         pRect->bottom - pRect->top,
+                         SWP_NOZORDER | SWP_NOACTIVATE);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onFocusIn() {
+        _focused = true;
+        if (_focusCallback != nullptr) {
+            _focusCallback(true);
+        }
+    }
+
+    SURFER_DEF void Window::Win32_onFocusOut() {
+        _focused = false;
+        std::memset(_keys, 0, sizeof(_keys)); // key ups go to the newly focused window
+        publishState();
+        if (_focusCallback != nullptr) {
+            _focusCallback(false);
+        }
+    }
+
+    SURFER_DEF KeyCode Window::Win32_translateKeyCode(WPARAM key) {
+        // Contiguous Ranges (Alphabet, Numbers, F-Keys, Numpad 0-9)
+
+        // Alphabet (A - Z)
+        if (key >= 0x41 && key <= 0x5A) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (key - 0x41));
+        }
+
+        // Numbers (0 - 9)
+        if (key >= 0x30 && key <= 0x39) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Num0) + (key - 0x30));
+        }
+
+        // Numpad (0 - 9)
+        if (key >= VK_NUMPAD0 && key <= VK_NUMPAD9) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Numpad0) + (key - VK_NUMPAD0));
+        }
+
+        // Function Keys (F1 - F12)
+        if (key >= VK_F1 && key <= VK_F12) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::F1) + (key - VK_F1));
+        }
+
+        // Specific Keys
+        switch (key) {
+            // Arrows
+            case VK_UP: return KeyCode::ArrowUp;
+            case VK_DOWN: return KeyCode::ArrowDown;
+            case VK_LEFT: return KeyCode::ArrowLeft;
+            case VK_RIGHT: return KeyCode::ArrowRight;
+
+            // Navigation
+            case VK_HOME: return KeyCode::Home;
+            case VK_END: return KeyCode::End;
+            case VK_PRIOR: return KeyCode::PageUp;
+            case VK_NEXT: return KeyCode::PageDown;
+
+            // Editing
+            case VK_BACK: return KeyCode::BackSpace;
+            case VK_DELETE: return KeyCode::Delete;
+            case VK_INSERT: return KeyCode::Insert;
+
+            // Special
+            case VK_ESCAPE: return KeyCode::Esc;
+            case VK_SPACE: return KeyCode::Space;
+            case VK_TAB: return KeyCode::Tab;
+            case VK_RETURN: return KeyCode::Enter; // NumpadEnter requires checking LPARAM (Extended Bit)
+            case VK_SNAPSHOT: return KeyCode::PrtSc;
+            case VK_PAUSE: return KeyCode::Pause;
+
+            // Numpad Math
+            case VK_MULTIPLY: return KeyCode::NumpadMultiply;
+            case VK_ADD: return KeyCode::NumpadAdd;
+            case VK_SUBTRACT: return KeyCode::NumpadSubtract;
+            case VK_DECIMAL: return KeyCode::NumpadDecimal;
+            case VK_DIVIDE: return KeyCode::NumpadDivide;
+
+            // Symbols (US Keyboard Layout Mappings)
+            case VK_OEM_PLUS: return KeyCode::Equal; // Shift + '=' is '+'
+            case VK_OEM_MINUS: return KeyCode::Minus;
+            case VK_OEM_COMMA: return KeyCode::Comma;
+            case VK_OEM_PERIOD: return KeyCode::Period;
+            case VK_OEM_1: return KeyCode::Semicolon; // ;:
+            case VK_OEM_2: return KeyCode::Slash; // /?
+            case VK_OEM_3: return KeyCode::Grave; // `~
+            case VK_OEM_4: return KeyCode::BracketLeft; // [{
+            case VK_OEM_5: return KeyCode::Backslash; // \|
+            case VK_OEM_6: return KeyCode::BracketRight; // ]}
+            case VK_OEM_7: return KeyCode::Apostrophe; // '"
+
+            // Locks
+            case VK_CAPITAL: return KeyCode::CapsLock;
+            case VK_NUMLOCK: return KeyCode::NumLock;
+            case VK_SCROLL: return KeyCode::ScrollLock;
+
+            // Modifiers
+            // Note: WM_KEYDOWN usually sends generic VK_SHIFT/CONTROL/MENU.
+            // We check GetKeyState to distinguish Left vs Right.
+
+            case VK_SHIFT:
+                if (GetKeyState(VK_LSHIFT) & 0x8000) return KeyCode::LeftShift;
+                if (GetKeyState(VK_RSHIFT) & 0x8000) return KeyCode::RightShift;
+                return KeyCode::LeftShift; // Fallback
+
+            case VK_CONTROL:
+                if (GetKeyState(VK_LCONTROL) & 0x8000) return KeyCode::LeftControl;
+                if (GetKeyState(VK_RCONTROL) & 0x8000) return KeyCode::RightControl;
+                return KeyCode::LeftControl;
+
+            case VK_MENU: // Alt Key
+                if (GetKeyState(VK_LMENU) & 0x8000) return KeyCode::LeftAlt;
+                if (GetKeyState(VK_RMENU) & 0x8000) return KeyCode::RightAlt;
+                return KeyCode::LeftAlt;
+
+            case VK_LWIN: return KeyCode::SuperLeft;
+            case VK_RWIN: return KeyCode::SuperRight;
+
+            // Direct mappings if Windows sends specific VKs
+            case VK_LSHIFT: return KeyCode::LeftShift;
+            case VK_RSHIFT: return KeyCode::RightShift;
+            case VK_LCONTROL: return KeyCode::LeftControl;
+            case VK_RCONTROL: return KeyCode::RightControl;
+            case VK_LMENU: return KeyCode::LeftAlt;
+            case VK_RMENU: return KeyCode::RightAlt;
+
+            default: return KeyCode::UnsupportedKey;
+        }
+    }
+#elif defined(SURFER_PLATFORM_X11)
+    SURFER_DEF Result Window::X11_createWindow(const std::string &title, const uint32_t width,
+                                               const uint32_t height, const int32_t x, const int32_t y) {
+        _width = width;
+        _height = height;
+        _x = x;
+        _y = y;
+        _title.assign(title.data(), title.size());
+
+        X11_display = XOpenDisplay(nullptr);
+        if (!X11_display) {
+            return Result::DisplayUnavailable;
+        }
+
+        X11_root = DefaultRootWindow(X11_display);
+        XSetWindowAttributes windowAttributes;
+        windowAttributes.background_pixel = WhitePixel(X11_display, 0);
+        X11_selectedEventMask = X11_eventMask();
+        windowAttributes.event_mask = X11_selectedEventMask;
+
+        X11_window = XCreateWindow(X11_display, X11_root, x, y, width, height, 0, CopyFromParent, InputOutput,
+                                   CopyFromParent, CWBackPixel | CWEventMask, &windowAttributes);
+
+        // Root ConfigureNotify tells us about monitor configuration changes
+        XSelectInput(X11_display, X11_root, StructureNotifyMask);
+
+        XStoreName(X11_display, X11_window, title.c_str());
+        XMapWindow(X11_display, X11_window);
+        XFlush(X11_display);
+
+        X11_internAtoms();
+        X11_maxChunkSize = static_cast<size_t>(XMaxRequestSize(X11_display)) * 4u / 2u;
+
+        X11_wmDeleteMessage = XInternAtom(X11_display, "WM_DELETE_WINDOW", False);
+        XSetWMProtocols(X11_display, X11_window, &X11_wmDeleteMessage, 1);
+
+        // Enable drag-and-drop support for the window (file drop handling), the property holds the XDND version
+        const Atom xdndVersion = X11_xdndVersion;
+        XChangeProperty(X11_display, X11_window, X11_atoms.xdndAware, XA_ATOM, 32, PropModeReplace,
+                        reinterpret_cast<const unsigned char *>(&xdndVersion), 1);
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+        // One wait set for the X connection, gamepads and user file descriptors. If it can not be created
+        // (out of file descriptors), X11_pollSources waits on them with poll() instead.
+        X11_epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (X11_epollFd >= 0) {
+            X11_watch(ConnectionNumber(X11_display), EPOLLIN, X11_SourceDisplay);
+        }
+#endif
+
+        // Held keys repeat KeyPress only instead of KeyRelease/KeyPress pairs
+        Bool detectableAutoRepeat = False;
+        XkbSetDetectableAutoRepeat(X11_display, True, &detectableAutoRepeat);
+        X11_detectableAutoRepeat = detectableAutoRepeat == True;
+
+        // Create XIM
+        XIM xim = XOpenIM(X11_display, nullptr, nullptr, nullptr);
+        if (xim) {
+            X11_xic = XCreateIC(
+                xim,
+                XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
+                XNClientWindow, X11_window,
+                nullptr
+            );
+        }
+        return Result::Ok;
+    }
+
+    SURFER_DEF void Window::X11_destroyWindow() {
+#if defined(SURFER_GAMEPAD_EVDEV)
+        for (uint32_t i = 0; i < MaxGamepads; i++) {
+            if (X11_gamepads[i].fd >= 0) {
+                close(X11_gamepads[i].fd);
+                X11_gamepads[i].fd = -1;
+            }
+        }
+        if (X11_inotifyFd >= 0) {
+            close(X11_inotifyFd);
+            X11_inotifyFd = -1;
+        }
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+        for (const X11_EventSource &source: X11_sources) {
+            if (source.timerCallback != nullptr && !source.removed) {
+                close(source.fd);
+            }
+        }
+        X11_sources.clear();
+        if (X11_epollFd >= 0) {
+            close(X11_epollFd);
+            X11_epollFd = -1;
+        }
+#endif
+
+        // Nothing below exists if the display could not be opened
+        if (!X11_display) {
+            return;
+        }
+
+        if (X11_framebuffer != nullptr) {
+            X11_destroyFramebuffer();
+            if (X11_framebuffer->gc != nullptr) {
+                XFreeGC(X11_display, X11_framebuffer->gc);
+            }
+            X11_framebuffer->~X11_SoftwareFramebuffer();
+            freeMemory(_allocator, X11_framebuffer);
+            X11_framebuffer = nullptr;
+        }
+
+        if (X11_window) {
+            XDestroyWindow(X11_display, X11_window);
+            X11_window = 0;
+        }
+
+        XCloseDisplay(X11_display);
+        X11_display = nullptr;
+    }
+
+    SURFER_DEF VkResult Window::X11_CreateSurface(VkInstance instance, VkSurfaceKHR *surface) {
+        VkXlibSurfaceCreateInfoKHR surfaceInfo = {};
+        surfaceInfo.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
+        surfaceInfo.dpy = X11_display;
+        surfaceInfo.window = X11_window;
+
+        return vkCreateXlibSurfaceKHR(instance, &surfaceInfo, _allocator, surface);
+    }
+
+    SURFER_DEF void Window::X11_pollEvents() {
+        X11_processEvents(0);
+    }
+
+    SURFER_DEF void Window::X11_waitEvents(int timeout) {
+        timeout = X11_clampToSelectionTimeout(clampToTimerWaiters(timeout));
+        // XPending flushes the output buffer, so the server sees our requests before we go to sleep
+        bool idle;
+        {
+            SURFER_TRACE_ZONE("XPending");
+            idle = XPending(X11_display) == 0;
+        }
+        X11_processEvents(idle ? timeout : 0);
+    }
+
+    SURFER_DEF bool Window::X11_processEvents(int timeout, uint32_t maxEvents, uint32_t maxMicros) {
+        SURFER_TRACE_ZONE("X11_processEvents");
+        beginPollInput();
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+        if (X11_epollFd >= 0) {
+            X11_dispatchSources(timeout);
+        } else {
+            X11_pollSources(timeout);
+        }
+#else
+        if (timeout != 0) {
+            pollfd fd = {};
+            fd.fd = ConnectionNumber(X11_display);
+            fd.events = POLLIN;
+            poll(&fd, 1, timeout);
+        }
+#endif
+
+#if defined(SURFER_ENABLE_METRICS)
+        const MetricsClock::time_point pollStart = MetricsClock::now();
+        uint32_t queueDepth;
+        {
+            SURFER_TRACE_ZONE("XEventsQueued");
+            queueDepth = static_cast<uint32_t>(XEventsQueued(X11_display, QueuedAfterReading));
+        }
+#endif
+
+        const bool budgeted = maxEvents != UINT32_MAX || maxMicros != UINT32_MAX;
+        if (budgeted) {
+            X11_processPriorityEvents();
+        }
+
+        // XPending reads from the connection once the queue is empty
+        auto pendingEvents = [this]() {
+            SURFER_TRACE_ZONE("XPending");
+            return XPending(X11_display);
+        };
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint32_t processed = 0;
+        XEvent event;
+        while (withinBudget(processed, maxEvents, maxMicros, start) && pendingEvents() > 0) {
+            {
+                SURFER_TRACE_ZONE("XNextEvent");
+                XNextEvent(X11_display, &event);
+            }
+            processed++;
+            X11_dispatchEvent(event);
+        }
+        const bool pending = budgeted && XEventsQueued(X11_display, QueuedAlready) > 0;
+        X11_finishLocalSelectionReads();
+        X11_expireSelectionTransfers();
+
+        dispatchTextInput();
+        finishMotionHistory();
+        resumeTimerWaiters();
+#if defined(SURFER_ENABLE_METRICS)
+        metricsRecordPoll(pollStart, queueDepth);
+#endif
+        publishState();
+        return pending;
+    }
+
+    SURFER_DEF void Window::X11_dispatchEvent(XEvent &event) {
+        // Let the input method consume events it needs for composition
+        bool filtered;
+        {
+            SURFER_TRACE_ZONE("XFilterEvent");
+            filtered = XFilterEvent(&event, 0);
+        }
+        if (filtered) {
+            return;
+        }
+
+        SURFER_TRACE_ZONE("X11_processEvent"); // includes the user callbacks
+#if defined(SURFER_ENABLE_METRICS)
+        const MetricsClock::time_point eventStart = MetricsClock::now();
+        X11_processEvent(event);
+        metricsRecordEvent(X11_eventType(event.type), eventStart);
+#else
+        X11_processEvent(event);
+#endif
+    }
+
+    SURFER_DEF void Window::X11_processPriorityEvents() {
+        XEvent event;
+        while (XCheckIfEvent(X11_display, &event, X11_isCloseRequest, reinterpret_cast<XPointer>(this))) {
+            X11_dispatchEvent(event);
+        }
+
+        // Intermediate sizes of a resize are stale anyway
+        XEvent configure;
+        bool hasConfigure = false;
+        while (XCheckTypedWindowEvent(X11_display, X11_window, ConfigureNotify, &event)) {
+            configure = event;
+            hasConfigure = true;
+        }
+        if (hasConfigure) {
+            X11_dispatchEvent(configure);
+        }
+    }
+
+    SURFER_DEF Bool Window::X11_isCloseRequest(Display *, XEvent *event, XPointer arg) {
+        const Window *window = reinterpret_cast<const Window *>(arg);
+        return event->type == ClientMessage && event->xclient.window == window->X11_window &&
+               event->xclient.message_type == window->X11_atoms.wmProtocols &&
+               static_cast<Atom>(event->xclient.data.l[0]) == window->X11_wmDeleteMessage;
+    }
+
+#if defined(SURFER_ENABLE_METRICS)
+    SURFER_DEF EventType Window::X11_eventType(int type) {
+        switch (type) {
+            case KeyPress:
+            case KeyRelease: return EventType::Key;
+            case ButtonPress:
+            case ButtonRelease: return EventType::MouseButton;
+            case MotionNotify: return EventType::MouseMotion;
+            case EnterNotify:
+            case LeaveNotify: return EventType::MouseCrossing;
+            case FocusIn:
+            case FocusOut: return EventType::Focus;
+            case ConfigureNotify: return EventType::Configure;
+            case Expose: return EventType::Redraw;
+            case ClientMessage: return EventType::WindowManager;
+            case SelectionClear:
+            case SelectionRequest:
+            case SelectionNotify:
+            case PropertyNotify: return EventType::Selection;
+            default: return EventType::Other;
+        }
+    }
+#endif
+
+#if defined(SURFER_EVENT_LOOP_EPOLL)
+    SURFER_DEF timespec Window::X11_toTimespec(double seconds) {
+        timespec time = {};
+        if (seconds > 0.0) {
+            time.tv_sec = static_cast<time_t>(seconds);
+            time.tv_nsec = static_cast<long>((seconds - static_cast<double>(time.tv_sec)) * 1e9);
+        }
+        return time;
+    }
+
+    SURFER_DEF bool Window::X11_watch(int fd, uint32_t events, X11_SourceKind kind) {
+        if (X11_epollFd < 0) {
+            return true; // X11_pollSources collects the fds every time
+        }
+        epoll_event event = {};
+        event.events = events;
+        event.data.u64 = (static_cast<uint64_t>(kind) << 32) | static_cast<uint32_t>(fd);
+        return epoll_ctl(X11_epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    SURFER_DEF void Window::X11_unwatch(int fd) {
+        if (X11_epollFd >= 0) {
+            epoll_ctl(X11_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+    }
+
+    SURFER_DEF bool Window::X11_addSource(int fd, uint32_t events, const FileDescriptorCallback &fdCallback,
+                                          const TimerCallback &timerCallback) {
+        if (!X11_watch(fd, events, X11_SourceUser)) {
+            return false;
+        }
+        X11_EventSource source = {fd, events, false, false, fdCallback, timerCallback};
+        X11_sources.push_back(source);
+        return true;
+    }
+
+    SURFER_DEF void Window::X11_removeSource(int fd, bool timer) {
+        // Sources are only marked here and erased before the next dispatch, so a callback can remove itself
+        for (X11_EventSource &source: X11_sources) {
+            if (source.fd == fd && !source.removed && (source.timerCallback != nullptr) == timer) {
+                X11_unwatch(fd);
+                source.removed = true;
+                if (timer) {
+                    close(fd);
                 }
-                case WM_RBUTTONUP: {
-                    if (window) {
-                        window->Win32_onButtonRelease(WM_RBUTTONUP);
+                return;
+            }
+        }
+    }
+
+    SURFER_DEF void Window::X11_dispatchSources(int timeout) {
+        X11_sources.erase(std::remove_if(X11_sources.begin(), X11_sources.end(),
+                                         [](const X11_EventSource &source) { return source.removed; }),
+                          X11_sources.end());
+
+        SURFER_TRACE_ZONE("X11_dispatchSources"); // includes the wait
+        // One pass only, sources that did not fit are level triggered and reported by the next poll. Looping
+        // until fewer are ready could spin forever on sources that stay ready (e.g. a hung up pipe).
+        epoll_event events[16];
+        const int count = epoll_wait(X11_epollFd, events, 16, timeout);
+        for (int i = 0; i < count; i++) {
+            X11_dispatchSource(static_cast<X11_SourceKind>(events[i].data.u64 >> 32),
+                               static_cast<int>(events[i].data.u64 & 0xFFFFFFFFu), events[i].events);
+        }
+    }
+
+    SURFER_DEF void Window::X11_pollSources(int timeout) {
+        X11_sources.erase(std::remove_if(X11_sources.begin(), X11_sources.end(),
+                                         [](const X11_EventSource &source) { return source.removed; }),
+                          X11_sources.end());
+
+        SURFER_TRACE_ZONE("X11_pollSources"); // includes the wait
+        // poll() uses the same bits as epoll for the input, output and error events
+        X11_pollFds.clear();
+        X11_pollFds.push_back(pollfd{ConnectionNumber(X11_display), POLLIN, 0});
+#if defined(SURFER_GAMEPAD_EVDEV)
+        if (X11_inotifyFd >= 0) {
+            X11_pollFds.push_back(pollfd{X11_inotifyFd, POLLIN, 0});
+        }
+        for (uint32_t pad = 0; pad < MaxGamepads; pad++) {
+            if (X11_gamepads[pad].fd >= 0) {
+                X11_pollFds.push_back(pollfd{X11_gamepads[pad].fd, POLLIN, 0});
+            }
+        }
+#endif
+        const size_t userBegin = X11_pollFds.size();
+        for (const X11_EventSource &source: X11_sources) {
+            X11_pollFds.push_back(pollfd{source.fd, static_cast<short>(source.events & 0xFFFFu), 0});
+        }
+
+        if (poll(X11_pollFds.data(), static_cast<nfds_t>(X11_pollFds.size()), timeout) <= 0) {
+            return;
+        }
+
+        // Callbacks may add sources, only the collected ones are dispatched
+        const size_t count = X11_pollFds.size();
+        for (size_t i = 1; i < count; i++) {
+            const pollfd fd = X11_pollFds[i];
+            if (fd.revents == 0) {
+                continue;
+            }
+            X11_SourceKind kind = X11_SourceUser;
+#if defined(SURFER_GAMEPAD_EVDEV)
+            if (i < userBegin) {
+                kind = fd.fd == X11_inotifyFd ? X11_SourceHotplug : X11_SourceGamepad;
+            }
+#endif
+            X11_dispatchSource(kind, fd.fd, static_cast<uint32_t>(fd.revents));
+        }
+    }
+
+    SURFER_DEF void Window::X11_dispatchSource(X11_SourceKind kind, int fd, uint32_t events) {
+        switch (kind) {
+            case X11_SourceDisplay:
+                break; // drained through XPending
+            case X11_SourceHotplug:
+                X11_processGamepadHotplug();
+                break;
+            case X11_SourceGamepad:
+                for (uint32_t pad = 0; pad < MaxGamepads; pad++) {
+                    if (X11_gamepads[pad].fd == fd) {
+                        X11_readGamepad(pad);
                     }
-                    return 0;
                 }
-                case WM_MBUTTONUP: {
-                    if (window) {
-                        window->Win32_onButtonRelease(WM_MBUTTONUP);
-                    }
-                    return 0;
+                break;
+            case X11_SourceUser:
+                X11_dispatchUserSource(fd, events);
+                break;
+        }
+    }
+
+    SURFER_DEF void Window::X11_dispatchUserSource(int fd, uint32_t events) {
+        // Index based, callbacks may add sources and reallocate the vector
+        for (size_t i = 0; i < X11_sources.size(); i++) {
+            if (X11_sources[i].fd != fd || X11_sources[i].removed) {
+                continue;
+            }
+
+            if (X11_sources[i].timerCallback != nullptr) {
+                uint64_t expirations = 0;
+                if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+                    return;
                 }
-                case WM_MOUSEMOVE: {
-                    int xPos = GET_X_LPARAM(lParam);
-                    int yPos = GET_Y_LPARAM(lParam);
-                    if (window) {
-                        window->Win32_onMouseMove(xPos, yPos);
-
-                        TRACKMOUSEEVENT tme = {};
-                        tme.cbSize = sizeof(tme);
-                        tme.dwFlags = TME_LEAVE;
-                        tme.hwndTrack = window->Win32_hWnd;
-                        TrackMouseEvent(&tme);
-
-                        if (!window->_mouseEntered) {
-                            window->Win32_onMouseEnter();
-                        }
-                    }
-                    return 0;
+                if (X11_sources[i].oneShot) {
+                    X11_removeSource(fd, true);
                 }
-                case WM_MOUSELEAVE: {
-                    if (window) {
-                        window->Win32_onMouseLeave();
-                    }
-                    return 0;
+                TimerCallback callback = X11_sources[i].timerCallback;
+                callback();
+            } else if (X11_sources[i].fdCallback != nullptr) {
+                FileDescriptorCallback callback = X11_sources[i].fdCallback;
+                callback(fd, events);
+            }
+            return;
+        }
+    }
+#endif
+
+    SURFER_DEF void Window::X11_processEvent(XEvent event) {
+        // Extension events have dynamic types
+        if (event.type == X11_shmCompletionEvent) {
+            X11_framebuffer->pending = false;
+            return;
+        }
+
+        switch (event.type) {
+            case ClientMessage: {
+                X11_onClientMessage(event);
+                break;
+            }
+            case KeyPress: {
+                X11_onKeyPress(event);
+                break;
+            }
+            case KeyRelease: {
+                // The following press is reported as a repeat since the key stays held
+                if (!X11_isRepeatRelease(event)) {
+                    X11_setKeycodeHeld(event.xkey.keycode, false);
+                    X11_onKeyRelease(event.xkey.keycode);
                 }
-                case WM_SIZE: // size changed
-                    if (window && wParam != SIZE_MINIMIZED) {
-                        if ((window->Win32_resizing) || ((wParam == SIZE_MAXIMIZED) || (wParam == SIZE_RESTORED))) {
-                            uint32_t width = LOWORD(lParam);
-                            uint32_t height = HIWORD(lParam);
-                            window->Win32_onResize(width, height);
-                        }
-                    }
-                    return 0;
-                case WM_ENTERSIZEMOVE: // resizing started
-                    window->Win32_resizing = true;
-                    return 0;
-                case WM_EXITSIZEMOVE: // resizing stopped
-                    window->Win32_resizing = false;
-                    return 0;
-                case WM_DPICHANGED:
-                    if (window) {
-                        window->Win32_onDpiChange(hWnd, wParam, lParam);
-                    }
-                    return 0;
-                case WM_MOVE: {
-                    if (window) {
-                        window->Win32_onMove(lParam);
+                break;
+            }
+            case ButtonPress: {
+                X11_onButtonPress(event.xbutton.button);
+                break;
+            }
+            case ButtonRelease: {
+                X11_onButtonRelease(event.xbutton.button);
+                break;
+            }
+            case MotionNotify: {
+                if (event.xmotion.is_hint == NotifyHint) {
+                    // Querying the pointer re-arms the hint for the next motion
+                    ::Window root, child;
+                    int rootX, rootY, x, y;
+                    unsigned int mask;
+                    if (XQueryPointer(X11_display, X11_window, &root, &child, &rootX, &rootY, &x, &y, &mask)) {
+                        X11_onMouseMotion(x, y);
                     }
-                    return 0;
+                    break;
                 }
-                case WM_SETFOCUS: {
-                    if (window) {
-                        window->Win32_onFocusIn();
-                    }
+                recordMotionSample(event.xmotion.x, event.xmotion.y, event.xmotion.time);
+                X11_onMouseMotion(event.xmotion.x, event.xmotion.y);
+                break;
+            }
+            case ConfigureNotify: {
+                const XConfigureEvent xce = event.xconfigure;
+
+                // The root window changes with the monitor configuration (RandR)
+                if (xce.window == X11_root) {
+                    invalidateSurfaceMonitor();
+                    break;
                 }
-                case WM_KILLFOCUS: {
-                    if (window && !window->shouldClose()) {
-                        window->Win32_onFocusOut();
-                    }
+
+                const bool moved = (xce.x != _x || xce.y != _y);
+                const bool resized = (xce.width != _width || xce.height != _height);
+
+                if (moved) {
+                    X11_onMove(xce.x, xce.y);
                 }
-                case WM_CHAR: {
-                    if (window) {
-                        window->Win32_onCharInput(wParam);
-                    }
-                    return 0;
+
+                if (resized) {
+                    X11_onResize(xce.width, xce.height);
                 }
-                case WM_SYSCHAR:
-                    return 0;
-                default:
-                    return DefWindowProc(hWnd, uMsg, wParam, lParam);
+
+                break;
+            }
+            case MapNotify:
+            case UnmapNotify: {
+                X11_mapped = event.type == MapNotify;
+                X11_updateVisibility();
+                break;
+            }
+            case VisibilityNotify: {
+                X11_obscured = event.xvisibility.state == VisibilityFullyObscured;
+                X11_updateVisibility();
+                break;
+            }
+            case FocusIn: {
+                X11_onFocusIn();
+                break;
+            }
+            case FocusOut: {
+                X11_onFocusOut();
+                break;
+            }
+            case EnterNotify: {
+                X11_onMouseEnter();
+                break;
+            }
+            case LeaveNotify: {
+                X11_onMouseLeave();
+                break;
             }
+            case SelectionRequest: {
+                X11_onSelectionRequest(event);
+                break;
+            }
+            case SelectionNotify: {
+                X11_onSelectionNotify(event);
+                break;
+            }
+            case SelectionClear: {
+                X11_onSelectionClear(event);
+                break;
+            }
+            case PropertyNotify: {
+                X11_onPropertyNotify(event);
+                break;
+            }
+        }
+    }
+
+    SURFER_DEF void Window::X11_onClose() {
+        _shouldClose = true;
+
+        XEvent event;
+        while (XPending(X11_display) > 0) {
+            XNextEvent(X11_display, &event);
+        }
+
+        if (_closeCallback != nullptr) {
+            _closeCallback();
         }
+    }
+
+    SURFER_DEF long Window::X11_eventMask() const {
+        // Keys and buttons feed the key state, structure and focus the window state, properties the clipboard
+        long mask = KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask | StructureNotifyMask |
+                    FocusChangeMask | PropertyChangeMask | PointerMotionMask | VisibilityChangeMask;
 
-        void Win32_onMouseEnter() {
-            _mouseEntered = true;
-            if (_mouseEnterExitCallback != nullptr) {
-                _mouseEnterExitCallback(true);
+        // The cursor position is always tracked, without a motion consumer one hint per motion burst is enough
+        if (_mouseMotionCallback == nullptr && _motionHistory.empty()) {
+            mask |= PointerMotionHintMask;
+        }
+        if (_mouseEnterExitCallback != nullptr) {
+            mask |= EnterWindowMask | LeaveWindowMask;
+        }
+        return mask;
+    }
+
+    SURFER_DEF void Window::X11_updateEventMask() {
+        const long mask = X11_eventMask();
+        if (mask != X11_selectedEventMask) {
+            XSelectInput(X11_display, X11_window, mask);
+            X11_selectedEventMask = mask;
+        }
+    }
+
+    SURFER_DEF void Window::X11_updateVisibility() {
+        setVisibility(X11_mapped && !X11_obscured && !X11_hidden, X11_hidden);
+    }
+
+    SURFER_DEF void Window::X11_onWmStateChange() {
+        Atom type;
+        int format;
+        unsigned long count, after;
+        unsigned char *data = nullptr;
+        X11_hidden = false;
+        if (XGetWindowProperty(X11_display, X11_window, X11_atoms.netWmState, 0, 1024, False, XA_ATOM, &type,
+                               &format, &count, &after, &data) == Success && data != nullptr) {
+            const Atom *states = reinterpret_cast<const Atom *>(data);
+            for (unsigned long i = 0; i < count; i++) {
+                if (states[i] == X11_atoms.netWmStateHidden) {
+                    X11_hidden = true;
+                }
             }
         }
+        if (data != nullptr) {
+            XFree(data);
+        }
+        X11_updateVisibility();
+    }
+
+    SURFER_DEF void Window::X11_onKeyPress(XEvent &event) {
+        const bool repeat = X11_isKeycodeHeld(event.xkey.keycode);
+        X11_setKeycodeHeld(event.xkey.keycode, true);
 
+        const KeyCode transledKeyCode = X11_translateKey(event.xkey.keycode);
+        setKeyState(transledKeyCode, true);
 
-        void Win32_onMouseLeave() {
-            _mouseEntered = false;
-            if (_mouseEnterExitCallback != nullptr) {
-                _mouseEnterExitCallback(false);
+        if (!repeat || dispatchKeyRepeat(transledKeyCode)) {
+            if (_keyPressCallback != nullptr) {
+                _keyPressCallback(transledKeyCode);
+            }
+            resumeKeyWaiters(transledKeyCode);
+            dispatchShortcut(transledKeyCode);
+
+            if (_nativeKeyPressCallback != nullptr) {
+                _nativeKeyPressCallback(XkbKeycodeToKeysym(X11_display, event.xkey.keycode, 0, 0));
             }
         }
 
-        void Win32_onCharInput(WPARAM wParam) {
-            static wchar_t high_surrogate = 0;
+        if (X11_xic != nullptr) {
+            X11_lookupText(event);
+        }
+    }
+
+    SURFER_DEF bool Window::X11_isKeycodeHeld(unsigned int keycode) const {
+        return keycode < 256u && ((X11_heldKeycodes[keycode / 64u] >> (keycode % 64u)) & 1u) != 0u;
+    }
 
-            if (!_characterInputCallback)
-                return;
+    SURFER_DEF void Window::X11_setKeycodeHeld(unsigned int keycode, bool held) {
+        if (keycode >= 256u) {
+            return;
+        }
+        const uint64_t bit = uint64_t(1) << (keycode % 64u);
+        X11_heldKeycodes[keycode / 64u] = held ? (X11_heldKeycodes[keycode / 64u] | bit) : (X11_heldKeycodes[keycode / 64u] & ~bit);
+    }
 
-            wchar_t wc = static_cast<wchar_t>(wParam);
+    SURFER_DEF bool Window::X11_isRepeatRelease(const XEvent &event) {
+        if (X11_detectableAutoRepeat) {
+            return false;
+        }
+        int queued;
+        {
+            SURFER_TRACE_ZONE("XEventsQueued");
+            queued = XEventsQueued(X11_display, QueuedAfterReading);
+        }
+        if (queued == 0) {
+            return false;
+        }
+        XEvent next;
+        XPeekEvent(X11_display, &next);
+        return next.type == KeyPress && next.xkey.keycode == event.xkey.keycode && next.xkey.time == event.xkey.time;
+    }
+
+    SURFER_DEF void Window::X11_lookupText(XEvent &event) {
+        SURFER_TRACE_ZONE("Xutf8LookupString");
+        // Converts key press to UTF-8 string according to layout and IME, directly into the text arena
+        const size_t offset = _textInput.size();
+        int capacity = 32;
+        Status status;
+
+        _textInput.resize(offset + capacity);
+        int n = Xutf8LookupString(X11_xic, &event.xkey, &_textInput[offset], capacity, nullptr, &status);
+        if (status == XBufferOverflow) {
+            // n holds the required size, IME commits and XTest pastes can easily exceed the default
+            capacity = n;
+            _textInput.resize(offset + capacity);
+            n = Xutf8LookupString(X11_xic, &event.xkey, &_textInput[offset], capacity, nullptr, &status);
+        }
 
-            uint32_t codepoint = 0;
+        const bool hasChars = (status == XLookupChars || status == XLookupBoth) && n > 0;
+        _textInput.resize(hasChars ? offset + n : offset);
+    }
 
-            // Handle surrogate pairs
-            if (wc >= 0xD800 && wc <= 0xDBFF) {
-                high_surrogate = wc;
-                return;
-            }
-            else if (wc >= 0xDC00 && wc <= 0xDFFF && high_surrogate) {
-                codepoint = 0x10000 + ((high_surrogate - 0xD800) << 10) + (wc - 0xDC00);
-                high_surrogate = 0;
-            }
-            else {
-                codepoint = static_cast<uint32_t>(wc);
-                high_surrogate = 0;
-            }
+    SURFER_DEF void Window::X11_onKeyRelease(unsigned int x11KeyCode) {
+        const KeyCode transledKeyCode = X11_translateKey(x11KeyCode);
+        setKeyState(transledKeyCode, false);
 
-            // Filter control characters
-            if (!(codepoint >= 0x20 || codepoint == '\n' || codepoint == '\t'))
-                return;
+        if (_keyReleaseCallback != nullptr) {
+            _keyReleaseCallback(transledKeyCode);
+        }
+
+        if (_nativeKeyReleaseCallback != nullptr) {
+            _nativeKeyReleaseCallback(XkbKeycodeToKeysym(X11_display, x11KeyCode, 0, 0));
+        }
+    }
+
+    SURFER_DEF KeyCode Window::X11_translateKey(unsigned int x11KeyCode) {
+        SURFER_TRACE_ZONE("X11_translateKey");
+        // X11 keycodes of evdev devices are offset by 8
+        if (_keyTranslationMode == KeyTranslationMode::Scancode) {
+            return x11KeyCode >= 8u ? translateScancode(x11KeyCode - 8u) : KeyCode::UnsupportedKey;
+        }
+        return X11_translateKeyCode(XkbKeycodeToKeysym(X11_display, x11KeyCode, 0, 0));
+    }
+
+    SURFER_DEF uint32_t Window::X11_getKeyCharacter(uint32_t scancode) const {
+        XkbStateRec state;
+        XkbGetState(X11_display, XkbUseCoreKbd, &state);
+        const KeySym keySym = XkbKeycodeToKeysym(X11_display, scancode + 8u, state.group, 0);
 
-            // Convert codepoint to UTF-8
-            char utf8[5] = {0}; // max 4 bytes + null terminator
-            if (codepoint <= 0x7F) {
-                utf8[0] = static_cast<char>(codepoint);
+        // Latin-1 keysyms equal their code points, Unicode keysyms carry it in the low bits
+        if ((keySym >= 0x20 && keySym <= 0x7E) || (keySym >= 0xA0 && keySym <= 0xFF)) {
+            return static_cast<uint32_t>(keySym);
+        }
+        if ((keySym & 0xFF000000) == 0x01000000) {
+            return static_cast<uint32_t>(keySym & 0x00FFFFFF);
+        }
+        return 0; // legacy keysyms (e.g. Latin-2) have no direct mapping
+    }
+
+    SURFER_DEF void Window::X11_onButtonPress(unsigned int x11button) {
+        const KeyCode key = X11_translateButton(x11button);
+        setKeyState(key, true);
+
+        // Each wheel notch is a press and release of a wheel button
+        if (key == KeyCode::MouseWheelUp) {
+            _wheel += 1.0f;
+        } else if (key == KeyCode::MouseWheelDown) {
+            _wheel -= 1.0f;
+        }
+
+        if (_keyPressCallback != nullptr) {
+            _keyPressCallback(key);
+        }
+
+        resumeKeyWaiters(key);
+        dispatchShortcut(key);
+    }
+
+    SURFER_DEF void Window::X11_onButtonRelease(unsigned int x11button) {
+        const KeyCode key = X11_translateButton(x11button);
+        setKeyState(key, false);
+
+        if (_keyReleaseCallback != nullptr) {
+            _keyReleaseCallback(key);
+        }
+    }
+
+    SURFER_DEF KeyCode Window::X11_translateButton(unsigned int x11button) {
+        switch (x11button) {
+            case Button1: return KeyCode::MouseLeft;
+            case Button2: return KeyCode::MouseRight;
+            case Button3: return KeyCode::MouseMiddle;
+            case Button4: return KeyCode::MouseWheelUp;
+            case Button5: return KeyCode::MouseWheelDown;
+            default: return KeyCode::UnsupportedKey;
+        }
+    }
+
+    SURFER_DEF void Window::X11_onMove(int32_t x, int32_t y) {
+        _x = x;
+        _y = y;
+
+        if (_moveCallback != nullptr) {
+            _moveCallback(x, y);
+        }
+    }
+
+    SURFER_DEF void Window::X11_onResize(const uint32_t width, const uint32_t height) {
+        // save the internal state
+        _width = width;
+        _height = height;
+        invalidateSurfaceExtent();
+
+        if (_resizeCallback != nullptr) {
+            _resizeCallback(width, height);
+        }
+
+        resumeResizeWaiters(width, height);
+    }
+
+    SURFER_DEF void Window::X11_onMouseMotion(uint32_t x, uint32_t y) {
+        if (_mouse_x != x || _mouse_y != y) {
+            // save the internal state
+            _mouse_x = x;
+            _mouse_y = y;
+
+            if (_mouseMotionCallback != nullptr) {
+                _mouseMotionCallback(x, y);
             }
-            else if (codepoint <= 0x7FF) {
-                utf8[0] = static_cast<char>(0xC0 | (codepoint >> 6));
-                utf8[1] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    SURFER_DEF void Window::X11_onFocusIn() {
+        _focused = true;
+        if (_focusCallback != nullptr) {
+            _focusCallback(true);
+        }
+    }
+
+    SURFER_DEF void Window::X11_onFocusOut() {
+        _focused = false;
+        std::memset(X11_heldKeycodes, 0, sizeof(X11_heldKeycodes)); // releases are not delivered while unfocused
+        std::memset(_keys, 0, sizeof(_keys));
+        publishState();
+        if (_focusCallback != nullptr) {
+            _focusCallback(false);
+        }
+    }
+
+    SURFER_DEF void Window::X11_onMouseEnter() {
+        _mouseEntered = true;
+        if (_mouseEnterExitCallback != nullptr) {
+            _mouseEnterExitCallback(true);
+        }
+    }
+
+    SURFER_DEF void Window::X11_onMouseLeave() {
+        _mouseEntered = false;
+        if (_mouseEnterExitCallback != nullptr) {
+            _mouseEnterExitCallback(false);
+        }
+    }
+
+    SURFER_DEF void Window::X11_internAtoms() {
+        char *names[] = {
+            const_cast<char *>("CLIPBOARD"), const_cast<char *>("TARGETS"), const_cast<char *>("INCR"),
+            const_cast<char *>("UTF8_STRING"), const_cast<char *>("text/plain;charset=utf-8"),
+            const_cast<char *>("text/plain"), const_cast<char *>("SURFER_SELECTION"),
+            const_cast<char *>("WM_PROTOCOLS"), const_cast<char *>("XdndAware"), const_cast<char *>("XdndEnter"),
+            const_cast<char *>("XdndPosition"), const_cast<char *>("XdndStatus"), const_cast<char *>("XdndLeave"),
+            const_cast<char *>("XdndDrop"), const_cast<char *>("XdndFinished"), const_cast<char *>("XdndSelection"),
+            const_cast<char *>("XdndTypeList"), const_cast<char *>("XdndActionCopy"),
+            const_cast<char *>("text/uri-list"), const_cast<char *>("_NET_WM_STATE"),
+            const_cast<char *>("_NET_WM_STATE_HIDDEN")
+        };
+        Atom atoms[sizeof(names) / sizeof(names[0])];
+        XInternAtoms(X11_display, names, sizeof(names) / sizeof(names[0]), False, atoms);
+
+        X11_atoms.clipboard = atoms[0];
+        X11_atoms.targets = atoms[1];
+        X11_atoms.incr = atoms[2];
+        X11_atoms.utf8String = atoms[3];
+        X11_atoms.textPlainUtf8 = atoms[4];
+        X11_atoms.textPlain = atoms[5];
+        X11_atoms.selectionProperty = atoms[6];
+        X11_atoms.wmProtocols = atoms[7];
+        X11_atoms.xdndAware = atoms[8];
+        X11_atoms.xdndEnter = atoms[9];
+        X11_atoms.xdndPosition = atoms[10];
+        X11_atoms.xdndStatus = atoms[11];
+        X11_atoms.xdndLeave = atoms[12];
+        X11_atoms.xdndDrop = atoms[13];
+        X11_atoms.xdndFinished = atoms[14];
+        X11_atoms.xdndSelection = atoms[15];
+        X11_atoms.xdndTypeList = atoms[16];
+        X11_atoms.xdndActionCopy = atoms[17];
+        X11_atoms.uriList = atoms[18];
+        X11_atoms.netWmState = atoms[19];
+        X11_atoms.netWmStateHidden = atoms[20];
+    }
+
+    SURFER_DEF Atom Window::X11_selectionAtom(Selection selection) const {
+        return selection == Selection::Clipboard ? X11_atoms.clipboard : XA_PRIMARY;
+    }
+
+    SURFER_DEF Window::X11_SelectionOffer *Window::X11_findOffer(Atom selection) {
+        if (selection == X11_atoms.clipboard) {
+            return &X11_offers[static_cast<uint32_t>(Selection::Clipboard)];
+        }
+        if (selection == XA_PRIMARY) {
+            return &X11_offers[static_cast<uint32_t>(Selection::Primary)];
+        }
+        return nullptr;
+    }
+
+    SURFER_DEF bool Window::X11_offerProvides(const X11_SelectionOffer &offer, Atom target) const {
+        if (offer.target == target) {
+            return true;
+        }
+        // Text is also offered under the common text aliases
+        return offer.target == X11_atoms.utf8String &&
+               (target == X11_atoms.textPlainUtf8 || target == X11_atoms.textPlain);
+    }
+
+    SURFER_DEF int &Window::X11_trappedError() {
+        static int error = 0;
+        return error;
+    }
+
+    SURFER_DEF Window::X11_ErrorTrap Window::X11_trapErrors() {
+        XSync(X11_display, False);
+        X11_trappedError() = 0;
+        return X11_ErrorTrap{XSetErrorHandler(X11_ErrorTrap::handler)};
+    }
+
+    SURFER_DEF int Window::X11_untrapErrors(const X11_ErrorTrap &trap) {
+        XSync(X11_display, False);
+        XSetErrorHandler(trap.previous);
+        return X11_trappedError();
+    }
+
+    SURFER_DEF void Window::X11_setSelection(Selection selection, const std::string &mimeType, std::string data) {
+        X11_SelectionOffer &offer = X11_offers[static_cast<uint32_t>(selection)];
+        offer.target = XInternAtom(X11_display, mimeType.c_str(), False);
+        offer.data = std::allocate_shared<const String>(Allocator<String>(_allocator), data.data(), data.size(),
+                                                        Allocator<char>(_allocator));
+
+        XSetSelectionOwner(X11_display, X11_selectionAtom(selection), X11_window, CurrentTime);
+        XFlush(X11_display);
+    }
+
+    SURFER_DEF void Window::X11_onSelectionClear(const XEvent &event) {
+        X11_SelectionOffer *offer = X11_findOffer(event.xselectionclear.selection);
+        if (offer != nullptr) {
+            // Another client took the selection over, transfers in flight keep their own reference
+            offer->data.reset();
+        }
+    }
+
+    SURFER_DEF void Window::X11_onSelectionRequest(const XEvent &event) {
+        const XSelectionRequestEvent &request = event.xselectionrequest;
+        XSelectionEvent reply = {};
+        reply.type = SelectionNotify;
+        reply.display = request.display;
+        reply.requestor = request.requestor;
+        reply.selection = request.selection;
+        reply.target = request.target;
+        reply.time = request.time;
+        reply.property = 0; // refused
+
+        // Obsolete clients may not specify the property
+        const Atom property = request.property != 0 ? request.property : request.target;
+        const X11_SelectionOffer *offer = X11_findOffer(request.selection);
+
+        const X11_ErrorTrap trap = X11_trapErrors();
+        if (offer != nullptr && offer->data) {
+            if (request.target == X11_atoms.targets) {
+                const Atom targets[] = {X11_atoms.targets, offer->target, X11_atoms.textPlainUtf8, X11_atoms.textPlain};
+                const int count = offer->target == X11_atoms.utf8String ? 4 : 2;
+                XChangeProperty(X11_display, request.requestor, property, XA_ATOM, 32, PropModeReplace,
+                                reinterpret_cast<const unsigned char *>(targets), count);
+                reply.property = property;
+            } else if (X11_offerProvides(*offer, request.target)) {
+                if (offer->data->size() > X11_maxChunkSize) {
+                    X11_startSelectionWrite(request.requestor, property, request.target, offer->data);
+                } else {
+                    XChangeProperty(X11_display, request.requestor, property, request.target, 8, PropModeReplace,
+                                    reinterpret_cast<const unsigned char *>(offer->data->data()),
+                                    static_cast<int>(offer->data->size()));
+                }
+                reply.property = property;
             }
-            else if (codepoint <= 0xFFFF) {
-                utf8[0] = static_cast<char>(0xE0 | (codepoint >> 12));
-                utf8[1] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                utf8[2] = static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+
+        XSendEvent(X11_display, request.requestor, False, 0, reinterpret_cast<XEvent *>(&reply));
+        X11_untrapErrors(trap);
+    }
+
+    SURFER_DEF void Window::X11_startSelectionWrite(::Window requestor, Atom property, Atom target,
+                                                    const std::shared_ptr<const String> &data) {
+        // Announce the total size, data follows in chunks as the requestor deletes the property. Selecting input
+        // replaces our event mask on that window, so it is done once per requestor and never on our own window
+        // (our own requests are served locally, and PropertyChangeMask is always selected there anyway).
+        const long size = static_cast<long>(data->size());
+        const bool listening = requestor == X11_window ||
+            std::any_of(X11_selectionWrites.begin(), X11_selectionWrites.end(),
+                        [requestor](const X11_SelectionWrite &write) { return write.requestor == requestor; });
+        if (!listening) {
+            XSelectInput(X11_display, requestor, PropertyChangeMask);
+        }
+        XChangeProperty(X11_display, requestor, property, X11_atoms.incr, 32, PropModeReplace,
+                        reinterpret_cast<const unsigned char *>(&size), 1);
+
+        X11_SelectionWrite write = {requestor, property, target, 0u, data, std::chrono::steady_clock::now()};
+        X11_selectionWrites.push_back(write);
+    }
+
+    SURFER_DEF void Window::X11_continueSelectionWrite(const XEvent &event) {
+        for (size_t i = 0; i < X11_selectionWrites.size(); i++) {
+            X11_SelectionWrite &write = X11_selectionWrites[i];
+            if (write.requestor != event.xproperty.window || write.property != event.xproperty.atom) {
+                continue;
             }
-            else { // <= 0x10FFFF
-                utf8[0] = static_cast<char>(0xF0 | (codepoint >> 18));
-                utf8[1] = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
-                utf8[2] = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-                utf8[3] = static_cast<char>(0x80 | (codepoint & 0x3F));
+
+            // A zero sized chunk marks the end of the transfer
+            const size_t chunk = std::min(X11_maxChunkSize, write.data->size() - write.offset);
+            const X11_ErrorTrap trap = X11_trapErrors();
+            XChangeProperty(X11_display, write.requestor, write.property, write.target, 8, PropModeReplace,
+                            reinterpret_cast<const unsigned char *>(write.data->data() + write.offset),
+                            static_cast<int>(chunk));
+            const bool failed = X11_untrapErrors(trap) != 0;
+
+            write.offset += chunk;
+            write.lastActivity = std::chrono::steady_clock::now();
+            if (chunk == 0u || failed) {
+                const ::Window requestor = write.requestor;
+                X11_selectionWrites.erase(X11_selectionWrites.begin() + i);
+                X11_releaseRequestor(requestor);
             }
+            return;
+        }
+    }
+
+    SURFER_DEF void Window::X11_requestSelection(Selection selection, const std::string &mimeType, const ClipboardCallback &callback) {
+        X11_SelectionRead read = {};
+        read.data = String(_allocator);
+        read.selection = X11_selectionAtom(selection);
+        read.target = XInternAtom(X11_display, mimeType.c_str(), False);
+        read.callback = callback;
+        X11_selectionReads.push_back(read);
+
+        X11_startSelectionRead();
+    }
+
+    SURFER_DEF void Window::X11_startSelectionRead() {
+        if (X11_selectionReads.empty() || X11_selectionReads.front().started) {
+            return;
+        }
 
-            // Call callback with UTF-8 string
-            _characterInputCallback(utf8);
+        X11_SelectionRead &read = X11_selectionReads.front();
+        read.started = true;
+        read.lastActivity = std::chrono::steady_clock::now();
+
+        // Our own data needs no round trip through the server, the callback still runs from the next poll
+        const X11_SelectionOffer *offer = read.drop ? nullptr : X11_findOffer(read.selection);
+        if (offer != nullptr && offer->data && X11_offerProvides(*offer, read.target)) {
+            read.data.assign(offer->data->data(), offer->data->size());
+            read.local = true;
+            return;
         }
 
-        void Win32_onKeyDown(WPARAM key) {
-            if (_keyPressCallback != nullptr) {
-                _keyPressCallback(Win32_translateKeyCode(key));
+        // The owner answers with SelectionNotify, if there is no owner the server answers right away
+        XDeleteProperty(X11_display, X11_window, X11_atoms.selectionProperty);
+        XConvertSelection(X11_display, read.selection, read.target, X11_atoms.selectionProperty, X11_window,
+                          read.time);
+        XFlush(X11_display);
+    }
+
+    SURFER_DEF void Window::X11_finishSelectionRead(bool success) {
+        X11_SelectionRead read = std::move(X11_selectionReads.front());
+        X11_selectionReads.erase(X11_selectionReads.begin());
+        X11_startSelectionRead();
+
+        if (read.drop) {
+            X11_finishDrop(success);
+        } else if (read.callback != nullptr) {
+            read.callback(success, success ? Span<char>(read.data.data(), read.data.size()) : Span<char>());
+        }
+    }
+
+    SURFER_DEF bool Window::X11_readSelectionProperty(Atom &type, String &data) {
+        int format = 0;
+        unsigned long count = 0, remaining = 0;
+        unsigned char *value = nullptr;
+
+        if (XGetWindowProperty(X11_display, X11_window, X11_atoms.selectionProperty, 0, LONG_MAX / 4, True,
+                               AnyPropertyType, &type, &format, &count, &remaining, &value) != Success) {
+            return false;
+        }
+
+        if (value != nullptr) {
+            // Xlib returns 32 bit items as longs
+            const size_t itemSize = format == 32 ? sizeof(long) : static_cast<size_t>(format / 8);
+            data.append(reinterpret_cast<const char *>(value), count * itemSize);
+            XFree(value);
+        }
+        return true;
+    }
+
+    SURFER_DEF void Window::X11_onSelectionNotify(const XEvent &event) {
+        if (X11_selectionReads.empty() || !X11_selectionReads.front().started ||
+            event.xselection.selection != X11_selectionReads.front().selection) {
+            return;
+        }
+
+        if (event.xselection.property == 0) {
+            X11_finishSelectionRead(false);
+            return;
+        }
+
+        X11_SelectionRead &read = X11_selectionReads.front();
+        Atom type = 0;
+        if (!X11_readSelectionProperty(type, read.data)) {
+            X11_finishSelectionRead(false);
+            return;
+        }
+
+        if (type == X11_atoms.incr) {
+            // Deleting the property told the owner to start sending chunks
+            read.data.clear();
+            read.incremental = true;
+            read.lastActivity = std::chrono::steady_clock::now();
+            return;
+        }
+
+        if (read.drop) {
+            X11_processDropData(read.data, true);
+        }
+        X11_finishSelectionRead(true);
+    }
+
+    SURFER_DEF void Window::X11_finishLocalSelectionReads() {
+        // Finishing starts the next read, which may be local as well
+        while (!X11_selectionReads.empty() && X11_selectionReads.front().local) {
+            X11_finishSelectionRead(true);
+        }
+    }
+
+    SURFER_DEF void Window::X11_releaseRequestor(::Window requestor) {
+        for (const X11_SelectionWrite &write: X11_selectionWrites) {
+            if (write.requestor == requestor) {
+                return;
+            }
+        }
+        if (requestor != X11_window) {
+            const X11_ErrorTrap trap = X11_trapErrors(); // the requestor may be gone
+            XSelectInput(X11_display, requestor, 0);
+            X11_untrapErrors(trap);
+        }
+    }
+
+    SURFER_DEF void Window::X11_expireSelectionTransfers() {
+        // Drop transfers to clients that went away
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < X11_selectionWrites.size();) {
+            if (now - X11_selectionWrites[i].lastActivity > X11_selectionTimeout()) {
+                const ::Window requestor = X11_selectionWrites[i].requestor;
+                X11_selectionWrites.erase(X11_selectionWrites.begin() + i);
+                X11_releaseRequestor(requestor);
+            } else {
+                i++;
             }
+        }
 
-            if (_nativeKeyPressCallback != nullptr) {
-                _nativeKeyPressCallback(key);
-            }
+        // Give up on an owner that stopped responding, otherwise it would block all further requests.
+        // Finishing starts the next read with a fresh deadline.
+        if (!X11_selectionReads.empty() && X11_selectionReads.front().started &&
+            now - X11_selectionReads.front().lastActivity > X11_selectionTimeout()) {
+            X11_finishSelectionRead(false);
         }
+    }
 
-        void Win32_onKeyUp(WPARAM key) {
-            if (_keyReleaseCallback != nullptr) {
-                _keyReleaseCallback(Win32_translateKeyCode(key));
+    SURFER_DEF int Window::X11_clampToSelectionTimeout(int timeout) const {
+        if (!X11_selectionReads.empty() && X11_selectionReads.front().local) {
+            return 0; // finished by the next poll
+        }
+        const auto now = std::chrono::steady_clock::now();
+        auto clamp = [&](std::chrono::steady_clock::time_point lastActivity) {
+            const std::chrono::steady_clock::time_point deadline = lastActivity + X11_selectionTimeout();
+            const int64_t remaining = deadline <= now ? 0 :
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+            if (timeout < 0 || remaining < timeout) {
+                timeout = static_cast<int>(remaining);
             }
+        };
+        for (size_t i = 0; i < X11_selectionWrites.size(); i++) {
+            clamp(X11_selectionWrites[i].lastActivity);
+        }
+        if (!X11_selectionReads.empty() && X11_selectionReads.front().started) {
+            clamp(X11_selectionReads.front().lastActivity);
+        }
+        return timeout;
+    }
 
-            if (_nativeKeyReleaseCallback != nullptr) {
-                _nativeKeyReleaseCallback(key);
+    SURFER_DEF void Window::X11_onPropertyNotify(const XEvent &event) {
+        if (event.xproperty.window != X11_window) {
+            if (event.xproperty.state == PropertyDelete) {
+                X11_continueSelectionWrite(event);
             }
+            return;
         }
 
-        void Win32_onClose() {
-            // Set should close first
-            _shouldClose = true;
+        if (event.xproperty.atom == X11_atoms.netWmState) {
+            X11_onWmStateChange();
+            return;
+        }
 
-            // Wait for any pending messages
-            MSG msg;
-            while (PeekMessage(&msg, Win32_hWnd, 0, 0, PM_REMOVE)) {
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
-            }
+        if (event.xproperty.state != PropertyNewValue || event.xproperty.atom != X11_atoms.selectionProperty ||
+            X11_selectionReads.empty() || !X11_selectionReads.front().incremental) {
+            return;
         }
 
-        void Win32_onDestroy() {
-            if (_closeCallback != nullptr)
-                _closeCallback();
+        X11_SelectionRead &read = X11_selectionReads.front();
+        const size_t size = read.data.size();
+        Atom type = 0;
+        if (!X11_readSelectionProperty(type, read.data)) {
+            X11_finishSelectionRead(false);
+            return;
         }
 
-        void Win32_onMouseMove(int xPos, int yPos) {
-            if (_mouse_x != xPos || _mouse_y != yPos) {
-                // save the internal state
-                _mouse_x = xPos;
-                _mouse_y = yPos;
+        read.lastActivity = std::chrono::steady_clock::now();
+        const bool last = read.data.size() == size; // zero sized chunk
+        if (read.drop) {
+            X11_processDropData(read.data, last);
+        }
+        if (last) {
+            X11_finishSelectionRead(true);
+        }
+    }
 
-                if (_mouseMotionCallback != nullptr) {
-                    _mouseMotionCallback(xPos, yPos);
-                }
+    SURFER_DEF void Window::X11_onClientMessage(const XEvent &event) {
+        if (event.xclient.message_type == X11_atoms.wmProtocols) {
+            if (static_cast<Atom>(event.xclient.data.l[0]) == X11_wmDeleteMessage) {
+                X11_onClose();
             }
+        } else if (event.xclient.message_type == X11_atoms.xdndEnter) {
+            X11_onDragEnter(event);
+        } else if (event.xclient.message_type == X11_atoms.xdndPosition) {
+            X11_onDragPosition(event);
+        } else if (event.xclient.message_type == X11_atoms.xdndLeave) {
+            X11_drag = X11_DragState();
+        } else if (event.xclient.message_type == X11_atoms.xdndDrop) {
+            X11_onDrop(event);
+        }
+    }
+
+    SURFER_DEF void Window::X11_sendDragMessage(::Window target, Atom type, long data1, long data2, long data4) {
+        XEvent message = {};
+        message.xclient.type = ClientMessage;
+        message.xclient.display = X11_display;
+        message.xclient.window = target;
+        message.xclient.message_type = type;
+        message.xclient.format = 32;
+        message.xclient.data.l[0] = static_cast<long>(X11_window);
+        message.xclient.data.l[1] = data1;
+        message.xclient.data.l[2] = data2;
+        message.xclient.data.l[4] = data4;
+
+        // XdndStatus answers every pointer move, so it is not synced; errors for a source
+        // that went away are dropped by the handler installed on enter
+        if (type == X11_atoms.xdndStatus && target != 0 && target == X11_drag.source) {
+            XSendEvent(X11_display, target, False, 0, &message);
+            XFlush(X11_display);
+            return;
         }
 
-        void Win32_onButtonPress(UINT button) {
-            switch (button) {
-                case WM_LBUTTONDOWN: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseLeft);
-                    }
-                    break;
-                }
-                case WM_RBUTTONDOWN: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseRight);
-                    }
-                    break;
-                }
-                case WM_MBUTTONDOWN: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseMiddle);
-                    }
-                    break;
-                }
-            }
+        const X11_ErrorTrap trap = X11_trapErrors();
+        XSendEvent(X11_display, target, False, 0, &message);
+        X11_untrapErrors(trap);
+    }
+
+    SURFER_DEF void Window::X11_ignoreDragSourceErrors(::Window source) {
+        X11_ErrorTrap::DragSources &sources = X11_ErrorTrap::dragSources();
+        sources.windows[sources.next++ % 4] = source;
+
+        // Stays installed after the drag, errors of the last replies may still be in flight
+        const XErrorHandler current = XSetErrorHandler(X11_ErrorTrap::dragHandler);
+        if (current != X11_ErrorTrap::dragHandler) {
+            sources.previous = current;
+        }
+    }
+
+    SURFER_DEF void Window::X11_onDragEnter(const XEvent &event) {
+        X11_drag = X11_DragState();
+        X11_drag.source = static_cast<::Window>(event.xclient.data.l[0]);
+        X11_ignoreDragSourceErrors(X11_drag.source);
+        X11_drag.version = static_cast<int>(static_cast<unsigned long>(event.xclient.data.l[1]) >> 24);
+        if (X11_drag.version > X11_xdndVersion) {
+            return;
         }
 
-        void Win32_onButtonRelease(UINT button) {
-            switch (button) {
-                case WM_LBUTTONUP: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseLeft);
-                    }
-                    break;
-                }
-                case WM_RBUTTONUP: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseRight);
-                    }
-                    break;
-                }
-                case WM_MBUTTONUP: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseMiddle);
-                    }
-                    break;
+        if (event.xclient.data.l[1] & 1) {
+            // More than three types, the full list is on the source window
+            Atom type = 0;
+            int format = 0;
+            unsigned long count = 0, remaining = 0;
+            unsigned char *value = nullptr;
+
+            const X11_ErrorTrap trap = X11_trapErrors();
+            XGetWindowProperty(X11_display, X11_drag.source, X11_atoms.xdndTypeList, 0, LONG_MAX / 4, False,
+                               XA_ATOM, &type, &format, &count, &remaining, &value);
+            X11_untrapErrors(trap);
+
+            if (value != nullptr) {
+                const Atom *types = reinterpret_cast<const Atom *>(value);
+                for (unsigned long i = 0; i < count; i++) {
+                    X11_drag.accepted = X11_drag.accepted || types[i] == X11_atoms.uriList;
                 }
+                XFree(value);
+            }
+        } else {
+            for (int i = 2; i < 5; i++) {
+                X11_drag.accepted = X11_drag.accepted || static_cast<Atom>(event.xclient.data.l[i]) == X11_atoms.uriList;
             }
         }
+    }
+
+    SURFER_DEF void Window::X11_onDragPosition(const XEvent &event) {
+        const ::Window source = static_cast<::Window>(event.xclient.data.l[0]);
+        const bool accept = X11_drag.accepted && X11_drag.source == source && _fileDropCallback != nullptr;
+
+        // Empty rectangle, we want a position message for every move
+        X11_sendDragMessage(source, X11_atoms.xdndStatus, accept ? 1 : 0, 0,
+                            accept ? static_cast<long>(X11_atoms.xdndActionCopy) : 0);
+    }
+
+    SURFER_DEF void Window::X11_onDrop(const XEvent &event) {
+        const ::Window source = static_cast<::Window>(event.xclient.data.l[0]);
+        if (!X11_drag.accepted || X11_drag.source != source || _fileDropCallback == nullptr) {
+            X11_sendDragMessage(source, X11_atoms.xdndFinished, 0, 0, 0);
+            X11_drag = X11_DragState();
+            return;
+        }
 
-        void Win32_onResize(uint32_t width, uint32_t height) {
-            _width = width;
-            _height = height;
+        // The uri list arrives as selection data, possibly in INCR chunks
+        X11_SelectionRead read = {};
+        read.data = String(_allocator);
+        read.selection = X11_atoms.xdndSelection;
+        read.target = X11_atoms.uriList;
+        read.time = X11_drag.version >= 1 ? static_cast<Time>(event.xclient.data.l[2]) : CurrentTime;
+        read.drop = true;
+        X11_selectionReads.push_back(read);
+        X11_startSelectionRead();
+    }
+
+    SURFER_DEF void Window::X11_finishDrop(bool success) {
+        if (X11_drag.source != 0) {
+            X11_sendDragMessage(X11_drag.source, X11_atoms.xdndFinished, success ? 1 : 0,
+                                success ? static_cast<long>(X11_atoms.xdndActionCopy) : 0, 0);
+        }
+        X11_drag = X11_DragState();
 
-            if (_resizeCallback != nullptr) {
-                _resizeCallback(width, height);
+        // The last batch of a successful drop was delivered with its data
+        if (!success && _fileDropCallback != nullptr) {
+            _fileDropCallback(Span<const char *>(), true);
+        }
+    }
+
+    SURFER_DEF int Window::X11_hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    SURFER_DEF void Window::X11_appendDropPath(const char *uri, size_t length) {
+        const char *end = uri + length;
+        if (length > 7 && std::strncmp(uri, "file://", 7) == 0) {
+            uri += 7;
+            while (uri < end && *uri != '/') {
+                uri++; // host name
             }
         }
 
-        void Win32_onMove(LPARAM lParam) {
-            int x = LOWORD(lParam);
-            int y = HIWORD(lParam);
-
-            if (x != _x || y != _y) {
-                _x = x;
-                _y = y;
-
-                if (_moveCallback != nullptr) {
-                    _moveCallback(x, y);
-                }
+        for (; uri < end; uri++) {
+            int high, low;
+            if (*uri == '%' && end - uri > 2 && (high = X11_hexValue(uri[1])) >= 0 &&
+                (low = X11_hexValue(uri[2])) >= 0) {
+                X11_dropPaths.push_back(static_cast<char>(high * 16 + low));
+                uri += 2;
+            } else {
+                X11_dropPaths.push_back(*uri);
             }
         }
+        X11_dropPaths.push_back('\0');
+    }
+
+    SURFER_DEF void Window::X11_processDropData(String &data, bool last) {
+        X11_dropPaths.clear();
+        X11_dropPathPointers.clear();
+
+        size_t start = 0;
+        while (start < data.size()) {
+            size_t newline = data.find('\n', start);
+            if (newline == String::npos) {
+                if (!last) {
+                    break;
+                }
+                newline = data.size();
+            }
 
-        void Win32_onDpiChange(HWND hWnd, WPARAM wParam, LPARAM lParam) {
-            UINT dpi = HIWORD(wParam);
-            RECT *const pRect = reinterpret_cast<RECT *>(lParam);
-
-            if (pRect) {
-                SetWindowPos(hWnd,
-                             nullptr,
-                             pRect->left,
-                             pRect->top,
-                             pRect->right - pRect->left,
-                             pRect->bottom - pRect->top,
-                             SWP_NOZORDER | SWP_NOACTIVATE);
+            size_t lineEnd = newline;
+            if (lineEnd > start && data[lineEnd - 1] == '\r') {
+                lineEnd--;
             }
+            if (lineEnd > start && data[start] != '#') {
+                X11_appendDropPath(data.data() + start, lineEnd - start);
+            }
+            start = newline + 1;
         }
+        data.erase(0, std::min(start, data.size()));
 
-        void Win32_onFocusIn() {
-            _focused = true;
-            if (_focusCallback != nullptr) {
-                _focusCallback(true);
-            }
+        // Pointers are collected only now, appending may have reallocated the buffer
+        for (size_t offset = 0; offset < X11_dropPaths.size(); offset += std::strlen(&X11_dropPaths[offset]) + 1) {
+            X11_dropPathPointers.push_back(&X11_dropPaths[offset]);
         }
 
-        void Win32_onFocusOut() {
-            _focused = false;
-            if (_focusCallback != nullptr) {
-                _focusCallback(false);
-            }
+        if (_fileDropCallback != nullptr && (!X11_dropPathPointers.empty() || last)) {
+            _fileDropCallback(Span<const char *>(X11_dropPathPointers.data(), X11_dropPathPointers.size()), last);
         }
+    }
 
-        KeyCode Win32_translateKeyCode(WPARAM key) {
-            // Contiguous Ranges (Alphabet, Numbers, F-Keys, Numpad 0-9)
+    SURFER_DEF void Window::X11_destroyFramebuffer() {
+        if (X11_framebuffer->image == nullptr) {
+            return;
+        }
 
-            // Alphabet (A - Z)
-            if (key >= 0x41 && key <= 0x5A) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (key - 0x41));
-            }
+        if (X11_framebuffer->useShm) {
+            // Requests are processed in order, so the server is done with the pixels before it detaches
+            XShmDetach(X11_display, &X11_framebuffer->shm);
+            X11_framebuffer->image->data = nullptr;
+            shmdt(X11_framebuffer->shm.shmaddr);
+        } else {
+            freeMemory(_allocator, X11_framebuffer->image->data);
+            X11_framebuffer->image->data = nullptr;
+        }
+        XDestroyImage(X11_framebuffer->image);
 
-            // Numbers (0 - 9)
-            if (key >= 0x30 && key <= 0x39) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Num0) + (key - 0x30));
-            }
+        X11_framebuffer->image = nullptr;
+        X11_framebuffer->shm = XShmSegmentInfo();
+        X11_framebuffer->useShm = false;
+        X11_framebuffer->pending = false;
+    }
 
-            // Numpad (0 - 9)
-            if (key >= VK_NUMPAD0 && key <= VK_NUMPAD9) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Numpad0) + (key - VK_NUMPAD0));
-            }
+    SURFER_DEF bool Window::X11_createShmFramebuffer(int screen) {
+        if (!XShmQueryExtension(X11_display)) {
+            return false;
+        }
 
-            // Function Keys (F1 - F12)
-            if (key >= VK_F1 && key <= VK_F12) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::F1) + (key - VK_F1));
-            }
+        Visual *visual = DefaultVisual(X11_display, screen);
+        const int depth = DefaultDepth(X11_display, screen);
 
-            // Specific Keys
-            switch (key) {
-                // Arrows
-                case VK_UP: return KeyCode::ArrowUp;
-                case VK_DOWN: return KeyCode::ArrowDown;
-                case VK_LEFT: return KeyCode::ArrowLeft;
-                case VK_RIGHT: return KeyCode::ArrowRight;
+        XShmSegmentInfo &shm = X11_framebuffer->shm;
+        XImage *image = XShmCreateImage(X11_display, visual, depth, ZPixmap, nullptr, &shm, _width, _height);
+        if (image == nullptr) {
+            return false;
+        }
 
-                // Navigation
-                case VK_HOME: return KeyCode::Home;
-                case VK_END: return KeyCode::End;
-                case VK_PRIOR: return KeyCode::PageUp;
-                case VK_NEXT: return KeyCode::PageDown;
+        shm.shmid = shmget(IPC_PRIVATE, static_cast<size_t>(image->bytes_per_line) * image->height, IPC_CREAT | 0600);
+        shm.shmaddr = shm.shmid >= 0 ? static_cast<char *>(shmat(shm.shmid, nullptr, 0)) : reinterpret_cast<char *>(-1);
+        if (shm.shmaddr == reinterpret_cast<char *>(-1)) {
+            if (shm.shmid >= 0) {
+                shmctl(shm.shmid, IPC_RMID, nullptr);
+            }
+            XDestroyImage(image);
+            return false;
+        }
+        image->data = shm.shmaddr;
+        shm.readOnly = False;
+
+        // Attaching fails on remote displays, the error is only reported asynchronously
+        const X11_ErrorTrap trap = X11_trapErrors();
+        XShmAttach(X11_display, &shm);
+        const bool attached = X11_untrapErrors(trap) == 0;
+
+        // The segment is destroyed once both sides detach
+        shmctl(shm.shmid, IPC_RMID, nullptr);
+
+        if (!attached) {
+            image->data = nullptr;
+            XDestroyImage(image);
+            shmdt(shm.shmaddr);
+            shm = XShmSegmentInfo();
+            return false;
+        }
 
-                // Editing
-                case VK_BACK: return KeyCode::BackSpace;
-                case VK_DELETE: return KeyCode::Delete;
-                case VK_INSERT: return KeyCode::Insert;
+        X11_framebuffer->image = image;
+        X11_framebuffer->useShm = true;
+        X11_shmCompletionEvent = XShmGetEventBase(X11_display) + ShmCompletion;
+        return true;
+    }
 
-                // Special
-                case VK_ESCAPE: return KeyCode::Esc;
-                case VK_SPACE: return KeyCode::Space;
-                case VK_TAB: return KeyCode::Tab;
-                case VK_RETURN: return KeyCode::Enter; // NumpadEnter requires checking LPARAM (Extended Bit)
-                case VK_SNAPSHOT: return KeyCode::PrtSc;
-                case VK_PAUSE: return KeyCode::Pause;
+    SURFER_DEF bool Window::X11_createFramebuffer() {
+        const int screen = DefaultScreen(X11_display);
+        Visual *visual = DefaultVisual(X11_display, screen);
+        const int depth = DefaultDepth(X11_display, screen);
 
-                // Numpad Math
-                case VK_MULTIPLY: return KeyCode::NumpadMultiply;
-                case VK_ADD: return KeyCode::NumpadAdd;
-                case VK_SUBTRACT: return KeyCode::NumpadSubtract;
-                case VK_DECIMAL: return KeyCode::NumpadDecimal;
-                case VK_DIVIDE: return KeyCode::NumpadDivide;
+        if (X11_framebuffer->gc == nullptr) {
+            X11_framebuffer->gc = XCreateGC(X11_display, X11_window, 0, nullptr);
+        }
 
-                // Symbols (US Keyboard Layout Mappings)
-                case VK_OEM_PLUS: return KeyCode::Equal; // Shift + '=' is '+'
-                case VK_OEM_MINUS: return KeyCode::Minus;
-                case VK_OEM_COMMA: return KeyCode::Comma;
-                case VK_OEM_PERIOD: return KeyCode::Period;
-                case VK_OEM_1: return KeyCode::Semicolon; // ;:
-                case VK_OEM_2: return KeyCode::Slash; // /?
-                case VK_OEM_3: return KeyCode::Grave; // `~
-                case VK_OEM_4: return KeyCode::BracketLeft; // [{
-                case VK_OEM_5: return KeyCode::Backslash; // \|
-                case VK_OEM_6: return KeyCode::BracketRight; // ]}
-                case VK_OEM_7: return KeyCode::Apostrophe; // '"
+        if (!X11_createShmFramebuffer(screen)) {
+            // Fallback, pixels are sent over the connection on every present
+            XImage *image = XCreateImage(X11_display, visual, depth, ZPixmap, 0, nullptr, _width, _height, 32, 0);
+            if (image == nullptr) {
+                return false;
+            }
+            image->data = static_cast<char *>(allocateMemory(_allocator, static_cast<size_t>(image->bytes_per_line) * image->height,
+                                                             alignof(uint32_t)));
+            if (image->data == nullptr) {
+                XDestroyImage(image);
+                return false;
+            }
+            X11_framebuffer->image = image;
+        }
 
-                // Locks
-                case VK_CAPITAL: return KeyCode::CapsLock;
-                case VK_NUMLOCK: return KeyCode::NumLock;
-                case VK_SCROLL: return KeyCode::ScrollLock;
+        // Only 32 bit pixels are exposed
+        if (X11_framebuffer->image->bits_per_pixel != 32) {
+            X11_destroyFramebuffer();
+            return false;
+        }
+        return true;
+    }
+
+    SURFER_DEF bool Window::X11_acquireFramebuffer(Framebuffer &framebuffer) {
+        if (X11_framebuffer == nullptr) {
+            void *memory = allocateMemory(_allocator, sizeof(X11_SoftwareFramebuffer), alignof(X11_SoftwareFramebuffer));
+            if (memory == nullptr) {
+                return false;
+            }
+            X11_framebuffer = new(memory) X11_SoftwareFramebuffer();
+        }
+        if (X11_framebuffer->pending) {
+            return false;
+        }
 
-                // Modifiers
-                // Note: WM_KEYDOWN usually sends generic VK_SHIFT/CONTROL/MENU.
-                // We check GetKeyState to distinguish Left vs Right.
+        XImage *image = X11_framebuffer->image;
+        if (image == nullptr || static_cast<uint32_t>(image->width) != _width ||
+            static_cast<uint32_t>(image->height) != _height) {
+            X11_destroyFramebuffer();
+            if (!X11_createFramebuffer()) {
+                return false;
+            }
+            image = X11_framebuffer->image;
+        }
 
-                case VK_SHIFT:
-                    if (GetKeyState(VK_LSHIFT) & 0x8000) return KeyCode::LeftShift;
-                    if (GetKeyState(VK_RSHIFT) & 0x8000) return KeyCode::RightShift;
-                    return KeyCode::LeftShift; // Fallback
+        framebuffer.pixels = image->data;
+        framebuffer.width = static_cast<uint32_t>(image->width);
+        framebuffer.height = static_cast<uint32_t>(image->height);
+        framebuffer.stride = static_cast<uint32_t>(image->bytes_per_line);
+        return true;
+    }
 
-                case VK_CONTROL:
-                    if (GetKeyState(VK_LCONTROL) & 0x8000) return KeyCode::LeftControl;
-                    if (GetKeyState(VK_RCONTROL) & 0x8000) return KeyCode::RightControl;
-                    return KeyCode::LeftControl;
+    SURFER_DEF void Window::X11_presentFramebuffer() {
+        if (X11_framebuffer == nullptr) {
+            return;
+        }
+        XImage *image = X11_framebuffer->image;
+        if (image == nullptr || X11_framebuffer->pending) {
+            return;
+        }
 
-                case VK_MENU: // Alt Key
-                    if (GetKeyState(VK_LMENU) & 0x8000) return KeyCode::LeftAlt;
-                    if (GetKeyState(VK_RMENU) & 0x8000) return KeyCode::RightAlt;
-                    return KeyCode::LeftAlt;
+        if (X11_framebuffer->useShm) {
+            // ShmCompletion tells us when the server is done reading the pixels
+            XShmPutImage(X11_display, X11_window, X11_framebuffer->gc, image, 0, 0, 0, 0,
+                         image->width, image->height, True);
+            X11_framebuffer->pending = true;
+        } else {
+            XPutImage(X11_display, X11_window, X11_framebuffer->gc, image, 0, 0, 0, 0, image->width, image->height);
+        }
+        XFlush(X11_display);
+    }
+
+#if defined(SURFER_GAMEPAD_EVDEV)
+    SURFER_DEF bool Window::X11_testBit(const unsigned long *bits, uint32_t bit) {
+        const uint32_t bitsPerLong = sizeof(unsigned long) * 8u;
+        return (bits[bit / bitsPerLong] >> (bit % bitsPerLong)) & 1ul;
+    }
+
+    SURFER_DEF int Window::X11_gamepadAxis(uint16_t code) {
+        switch (code) {
+            case ABS_X: return static_cast<int>(GamepadAxis::LeftX);
+            case ABS_Y: return static_cast<int>(GamepadAxis::LeftY);
+            case ABS_RX: return static_cast<int>(GamepadAxis::RightX);
+            case ABS_RY: return static_cast<int>(GamepadAxis::RightY);
+            case ABS_Z:
+            case ABS_BRAKE: return static_cast<int>(GamepadAxis::LeftTrigger);
+            case ABS_RZ:
+            case ABS_GAS: return static_cast<int>(GamepadAxis::RightTrigger);
+            default: return -1;
+        }
+    }
+
+    SURFER_DEF int Window::X11_gamepadButton(uint16_t code) {
+        switch (code) {
+            case BTN_A: return static_cast<int>(GamepadButton::A);
+            case BTN_B: return static_cast<int>(GamepadButton::B);
+            case BTN_X: return static_cast<int>(GamepadButton::X);
+            case BTN_Y: return static_cast<int>(GamepadButton::Y);
+            case BTN_TL: return static_cast<int>(GamepadButton::LeftBumper);
+            case BTN_TR: return static_cast<int>(GamepadButton::RightBumper);
+            case BTN_SELECT: return static_cast<int>(GamepadButton::Back);
+            case BTN_START: return static_cast<int>(GamepadButton::Start);
+            case BTN_MODE: return static_cast<int>(GamepadButton::Guide);
+            case BTN_THUMBL: return static_cast<int>(GamepadButton::LeftThumb);
+            case BTN_THUMBR: return static_cast<int>(GamepadButton::RightThumb);
+            case BTN_DPAD_UP: return static_cast<int>(GamepadButton::DpadUp);
+            case BTN_DPAD_DOWN: return static_cast<int>(GamepadButton::DpadDown);
+            case BTN_DPAD_LEFT: return static_cast<int>(GamepadButton::DpadLeft);
+            case BTN_DPAD_RIGHT: return static_cast<int>(GamepadButton::DpadRight);
+            default: return -1;
+        }
+    }
+
+    SURFER_DEF void Window::X11_setGamepadButton(GamepadState &state, GamepadButton button, bool down) {
+        const uint32_t bit = 1u << static_cast<uint32_t>(button);
+        state.buttons = down ? (state.buttons | bit) : (state.buttons & ~bit);
+    }
+
+    SURFER_DEF void Window::X11_enableGamepads() {
+        // Watch for hot-plugged devices, udev fixes permissions after creation, hence IN_ATTRIB.
+        // Hot-plug is optional, without it (e.g. out of inotify instances) the gamepads found below still work.
+        if (X11_inotifyFd < 0) {
+            X11_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (X11_inotifyFd >= 0 &&
+                (inotify_add_watch(X11_inotifyFd, "/dev/input", IN_CREATE | IN_ATTRIB | IN_DELETE) < 0 ||
+                 !X11_watch(X11_inotifyFd, EPOLLIN, X11_SourceHotplug))) {
+                close(X11_inotifyFd);
+                X11_inotifyFd = -1;
+            }
+        }
 
-                case VK_LWIN: return KeyCode::SuperLeft;
-                case VK_RWIN: return KeyCode::SuperRight;
+        // Gamepads that are already open are skipped
+        DIR *dir = opendir("/dev/input");
+        if (dir) {
+            while (dirent *entry = readdir(dir)) {
+                if (std::strncmp(entry->d_name, "event", 5) == 0) {
+                    char path[sizeof(X11_GamepadDevice::path)];
+                    const int length = std::snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+                    if (length > 0 && static_cast<size_t>(length) < sizeof(path)) {
+                        X11_openGamepad(path);
+                    }
+                }
+            }
+            closedir(dir);
+        }
+    }
 
-                // Direct mappings if Windows sends specific VKs
-                case VK_LSHIFT: return KeyCode::LeftShift;
-                case VK_RSHIFT: return KeyCode::RightShift;
-                case VK_LCONTROL: return KeyCode::LeftControl;
-                case VK_RCONTROL: return KeyCode::RightControl;
-                case VK_LMENU: return KeyCode::LeftAlt;
-                case VK_RMENU: return KeyCode::RightAlt;
-
-                default: return KeyCode::UnsupportedKey;
+    SURFER_DEF void Window::X11_openGamepad(const char *path) {
+        int slot = -1;
+        for (uint32_t i = 0; i < MaxGamepads; i++) {
+            if (X11_gamepads[i].fd >= 0 && std::strcmp(X11_gamepads[i].path, path) == 0) {
+                return; // already open
+            }
+            if (X11_gamepads[i].fd < 0 && slot < 0) {
+                slot = static_cast<int>(i);
             }
         }
+        if (slot < 0) {
+            return;
+        }
+
+        const int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
 
+        const uint32_t bitsPerLong = sizeof(unsigned long) * 8u;
+        unsigned long keyBits[(KEY_MAX + bitsPerLong) / bitsPerLong] = {};
+        unsigned long absBits[(ABS_MAX + bitsPerLong) / bitsPerLong] = {};
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits);
+        ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits);
 
-#elif defined(SURFER_PLATFORM_X11)
-        Display *X11_display;
-        ::Window X11_window;
-        ::Window X11_root;
-        Atom X11_wmDeleteMessage;
-        XIC X11_xic = nullptr;
-
-        void X11_createWindow(const std::string &title, const uint32_t width,
-                              const uint32_t height, const int32_t x, const int32_t y) {
-            _width = width;
-            _height = height;
-            _x = x;
-            _y = y;
-            _title = title;
+        // Keyboards, mice and touchpads are evdev devices too
+        if (!X11_testBit(keyBits, BTN_GAMEPAD) && !X11_testBit(keyBits, BTN_JOYSTICK)) {
+            close(fd);
+            return;
+        }
 
-            X11_display = XOpenDisplay(nullptr);
-            if (!X11_display) {
-                throw std::runtime_error("VulkanSurfer: Failed to open X display");
+        X11_GamepadDevice &pad = X11_gamepads[slot];
+        pad = X11_GamepadDevice();
+        pad.fd = fd;
+        std::snprintf(pad.path, sizeof(pad.path), "%s", path);
+        for (uint16_t code = 0; code <= ABS_MAX; code++) {
+            const int axis = X11_gamepadAxis(code);
+            input_absinfo info = {};
+            if (axis >= 0 && X11_testBit(absBits, code) && (pad.analogAxes & (1u << axis)) == 0u &&
+                ioctl(fd, EVIOCGABS(code), &info) >= 0) {
+                pad.axisMinimum[axis] = info.minimum;
+                pad.axisMaximum[axis] = info.maximum;
+                pad.analogAxes |= 1u << axis;
             }
+        }
 
-            X11_root = DefaultRootWindow(X11_display);
-            XSetWindowAttributes windowAttributes;
-            windowAttributes.background_pixel = WhitePixel(X11_display, 0);
-            windowAttributes.event_mask =
-                    ExposureMask | KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask |
-                    PointerMotionMask | StructureNotifyMask | FocusChangeMask | EnterWindowMask |
-                    LeaveWindowMask | ButtonMotionMask | FocusChangeMask | KeymapStateMask |
-                    ExposureMask;
+        pad.state.connected = true;
+        X11_syncGamepad(pad);
+        X11_watch(fd, EPOLLIN, X11_SourceGamepad);
 
-            X11_window = XCreateWindow(X11_display, X11_root, x, y, width, height, 0, CopyFromParent, InputOutput,
-                                       CopyFromParent, CWBackPixel | CWEventMask, &windowAttributes);
+        if (_gamepadConnectionCallback != nullptr) {
+            _gamepadConnectionCallback(static_cast<uint32_t>(slot), true);
+        }
+    }
 
-            XStoreName(X11_display, X11_window, title.c_str());
-            XMapWindow(X11_display, X11_window);
-            XFlush(X11_display);
+    SURFER_DEF void Window::X11_closeGamepad(uint32_t index) {
+        X11_unwatch(X11_gamepads[index].fd);
+        close(X11_gamepads[index].fd);
+        X11_gamepads[index] = X11_GamepadDevice();
 
-            X11_wmDeleteMessage = XInternAtom(X11_display, "WM_DELETE_WINDOW", False);
-            XSetWMProtocols(X11_display, X11_window, &X11_wmDeleteMessage, 1);
+        if (_gamepadConnectionCallback != nullptr) {
+            _gamepadConnectionCallback(index, false);
+        }
+    }
 
-            // Enable drag-and-drop support for the window (file drop handling)
-            Atom XdndAware = XInternAtom(X11_display, "XdndAware", False);
-            XChangeProperty(X11_display, X11_window, XdndAware, XA_ATOM, 32, PropModeReplace,
-                            (unsigned char *) &XdndAware, 1);
+    SURFER_DEF void Window::X11_syncGamepad(X11_GamepadDevice &pad) {
+        const uint32_t bitsPerLong = sizeof(unsigned long) * 8u;
+        unsigned long keyState[(KEY_MAX + bitsPerLong) / bitsPerLong] = {};
+        ioctl(pad.fd, EVIOCGKEY(sizeof(keyState)), keyState);
 
-            // Create XIM
-            XIM xim = XOpenIM(X11_display, nullptr, nullptr, nullptr);
-            if (xim) {
-                X11_xic = XCreateIC(
-                    xim,
-                    XNInputStyle, XIMPreeditNothing | XIMStatusNothing,
-                    XNClientWindow, X11_window,
-                    nullptr
-                );
-            }
+        for (uint16_t code = BTN_MISC; code <= BTN_DPAD_RIGHT; code++) {
+            X11_processGamepadKey(pad, code, X11_testBit(keyState, code) ? 1 : 0);
         }
 
-        void X11_destroyWindow() {
-            if (X11_window) {
-                XDestroyWindow(X11_display, X11_window);
-                X11_window = 0;
-            }
-
-            if (X11_display) {
-                XCloseDisplay(X11_display);
-                X11_display = nullptr;
+        for (uint16_t code = 0; code <= ABS_MAX; code++) {
+            const int axis = X11_gamepadAxis(code);
+            input_absinfo info = {};
+            if ((axis >= 0 || code == ABS_HAT0X || code == ABS_HAT0Y) && ioctl(pad.fd, EVIOCGABS(code), &info) >= 0) {
+                X11_processGamepadAxis(pad, code, info.value);
             }
         }
+    }
 
-        VkResult X11_CreateSurface(VkInstance instance, VkSurfaceKHR *surface) {
-            VkXlibSurfaceCreateInfoKHR surfaceInfo = {};
-            surfaceInfo.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
-            surfaceInfo.dpy = X11_display;
-            surfaceInfo.window = X11_window;
+    SURFER_DEF void Window::X11_processGamepadKey(X11_GamepadDevice &pad, uint16_t code, int32_t value) {
+        const int button = X11_gamepadButton(code);
+        if (button >= 0) {
+            X11_setGamepadButton(pad.state, static_cast<GamepadButton>(button), value != 0);
+            return;
+        }
 
-            return vkCreateXlibSurfaceKHR(instance, &surfaceInfo, nullptr, surface);
+        // Pads without analog triggers report them as buttons
+        const uint32_t left = static_cast<uint32_t>(GamepadAxis::LeftTrigger);
+        const uint32_t right = static_cast<uint32_t>(GamepadAxis::RightTrigger);
+        if (code == BTN_TL2 && (pad.analogAxes & (1u << left)) == 0u) {
+            pad.state.axes[left] = value != 0 ? 1.0f : 0.0f;
+        } else if (code == BTN_TR2 && (pad.analogAxes & (1u << right)) == 0u) {
+            pad.state.axes[right] = value != 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    SURFER_DEF void Window::X11_processGamepadAxis(X11_GamepadDevice &pad, uint16_t code, int32_t value) {
+        // D-pad reported as hat
+        if (code == ABS_HAT0X) {
+            X11_setGamepadButton(pad.state, GamepadButton::DpadLeft, value < 0);
+            X11_setGamepadButton(pad.state, GamepadButton::DpadRight, value > 0);
+            return;
+        }
+        if (code == ABS_HAT0Y) {
+            X11_setGamepadButton(pad.state, GamepadButton::DpadUp, value < 0);
+            X11_setGamepadButton(pad.state, GamepadButton::DpadDown, value > 0);
+            return;
         }
 
-        void X11_pollEvents() {
-            XEvent event;
-            while (XPending(X11_display) > 0) {
-                XNextEvent(X11_display, &event);
-                X11_processEvent(event);
-            }
+        const int axis = X11_gamepadAxis(code);
+        if (axis < 0 || (pad.analogAxes & (1u << axis)) == 0u) {
+            return;
         }
 
-        void X11_processEvent(XEvent event) {
-            switch (event.type) {
-                case ClientMessage: {
-                    X11_onClose();
-                    break;
-                }
-                case KeyPress: {
-                    X11_onKeyPress(&event.xkey);
-                    break;
+        const float range = static_cast<float>(pad.axisMaximum[axis] - pad.axisMinimum[axis]);
+        const float normalized = range > 0.0f ? static_cast<float>(value - pad.axisMinimum[axis]) / range : 0.0f;
+        const bool trigger = axis >= static_cast<int>(GamepadAxis::LeftTrigger);
+        pad.state.axes[axis] = trigger ? normalized : normalized * 2.0f - 1.0f;
+    }
+
+    SURFER_DEF void Window::X11_readGamepad(uint32_t index) {
+        X11_GamepadDevice &pad = X11_gamepads[index];
+        input_event events[32];
+
+        for (;;) {
+            const ssize_t bytes = read(pad.fd, events, sizeof(events));
+            if (bytes < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
-                case KeyRelease: {
-                    X11_onKeyRelease(event.xkey.keycode);
-                    break;
-                }
-                case ButtonPress: {
-                    X11_onButtonPress(event.xbutton.button);
-                    break;
+                if (errno != EAGAIN) {
+                    X11_closeGamepad(index); // ENODEV when unplugged
                 }
-                case ButtonRelease: {
-                    X11_onButtonRelease(event.xbutton.button);
-                    break;
-                }
-                case MotionNotify: {
-                    X11_onMouseMotion(event.xmotion.x, event.xmotion.y);
-                    break;
+                return;
+            }
+
+            const size_t count = static_cast<size_t>(bytes) / sizeof(input_event);
+            for (size_t i = 0; i < count; i++) {
+                const input_event &event = events[i];
+                if (event.type == EV_SYN) {
+                    if (event.code == SYN_DROPPED) {
+                        pad.dropped = true;
+                    } else if (event.code == SYN_REPORT && pad.dropped) {
+                        pad.dropped = false;
+                        X11_syncGamepad(pad);
+                    }
+                } else if (pad.dropped) {
+                    continue;
+                } else if (event.type == EV_KEY) {
+                    X11_processGamepadKey(pad, event.code, event.value);
+                } else if (event.type == EV_ABS) {
+                    X11_processGamepadAxis(pad, event.code, event.value);
                 }
-                case ConfigureNotify: {
-                    const XConfigureEvent xce = event.xconfigure;
+            }
 
-                    const bool moved = (xce.x != _x || xce.y != _y);
-                    const bool resized = (xce.width != _width || xce.height != _height);
+            if (count < sizeof(events) / sizeof(events[0])) {
+                return;
+            }
+        }
+    }
 
-                    if (moved) {
-                        X11_onMove(xce.x, xce.y);
-                    }
+    SURFER_DEF void Window::X11_processGamepadHotplug() {
+        alignas(inotify_event) char buffer[4096];
 
-                    if (resized) {
-                        X11_onResize(xce.width, xce.height);
-                    }
+        for (;;) {
+            const ssize_t length = read(X11_inotifyFd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                return;
+            }
 
-                    break;
-                }
-                case FocusIn: {
-                    X11_onFocusIn();
-                    break;
-                }
-                case FocusOut: {
-                    X11_onFocusOut();
-                    break;
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+
+                if (event->len == 0 || std::strncmp(event->name, "event", 5) != 0) {
+                    continue;
                 }
-                case EnterNotify: {
-                    X11_onMouseEnter();
-                    break;
+
+                // A truncated name could match another device
+                char path[sizeof(X11_GamepadDevice::path)];
+                const int pathLength = std::snprintf(path, sizeof(path), "/dev/input/%s", event->name);
+                if (pathLength <= 0 || static_cast<size_t>(pathLength) >= sizeof(path)) {
+                    continue;
                 }
-                case LeaveNotify: {
-                    X11_onMouseLeave();
-                    break;
+                if (event->mask & (IN_CREATE | IN_ATTRIB)) {
+                    X11_openGamepad(path);
+                } else if (event->mask & IN_DELETE) {
+                    for (uint32_t i = 0; i < MaxGamepads; i++) {
+                        if (X11_gamepads[i].fd >= 0 && std::strcmp(X11_gamepads[i].path, path) == 0) {
+                            X11_closeGamepad(i);
+                        }
+                    }
                 }
             }
         }
+    }
+#endif
 
-        void X11_onClose() {
-            _shouldClose = true;
+    SURFER_DEF KeyCode Window::X11_translateKeyCode(KeySym keySym) {
+        // Contiguous Ranges
 
-            XEvent event;
-            while (XPending(X11_display) > 0) {
-                XNextEvent(X11_display, &event);
-            }
+        // Alphabet (a-z, A-Z)
+        if (keySym >= XK_a && keySym <= XK_z) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (keySym - XK_a));
+        }
+        if (keySym >= XK_A && keySym <= XK_Z) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (keySym - XK_A));
+        }
 
-            if (_closeCallback != nullptr) {
-                _closeCallback();
-            }
+        // Numbers (0-9)
+        if (keySym >= XK_0 && keySym <= XK_9) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Num0) + (keySym - XK_0));
         }
 
-        void X11_onKeyPress(XKeyEvent* event) {
-            KeySym keySym = XkbKeycodeToKeysym(X11_display, event->keycode, 0, 0);
-            const KeyCode transledKeyCode = X11_translateKeyCode(keySym);
+        // Numpad Numbers (0-9)
+        if (keySym >= XK_KP_0 && keySym <= XK_KP_9) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Numpad0) + (keySym - XK_KP_0));
+        }
 
-            if (_keyPressCallback != nullptr) {
-                _keyPressCallback(transledKeyCode);
+        // Function Keys (F1 - F12)
+        // Note: XK_F1 to XK_F12 are contiguous in X11 (0xFFBE to 0xFFC9)
+        if (keySym >= XK_F1 && keySym <= XK_F12) {
+            return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::F1) + (keySym - XK_F1));
+        }
+
+        // Specific Key Mappings
+        switch (keySym) {
+            // Arrows
+            case XK_Up: return KeyCode::ArrowUp;
+            case XK_Down: return KeyCode::ArrowDown;
+            case XK_Left: return KeyCode::ArrowLeft;
+            case XK_Right: return KeyCode::ArrowRight;
+
+            // Navigation
+            case XK_Home: return KeyCode::Home;
+            case XK_End: return KeyCode::End;
+            case XK_Page_Up: return KeyCode::PageUp;
+            case XK_Page_Down: return KeyCode::PageDown;
+
+            // Editing
+            case XK_BackSpace: return KeyCode::BackSpace;
+            case XK_Delete: return KeyCode::Delete;
+            case XK_Insert: return KeyCode::Insert;
+
+            // Special
+            case XK_Return: return KeyCode::Enter;
+            case XK_space: return KeyCode::Space;
+            case XK_Tab: return KeyCode::Tab;
+            case XK_Escape: return KeyCode::Esc;
+            case XK_Print: return KeyCode::PrtSc;
+            case XK_Pause: return KeyCode::Pause;
+            case XK_Break: return KeyCode::Pause;
+
+            // Modifiers
+            case XK_Shift_L: return KeyCode::LeftShift;
+            case XK_Shift_R: return KeyCode::RightShift;
+            case XK_Control_L: return KeyCode::LeftControl;
+            case XK_Control_R: return KeyCode::RightControl;
+            case XK_Alt_L: return KeyCode::LeftAlt;
+            case XK_Alt_R: return KeyCode::RightAlt;
+            case XK_Super_L: return KeyCode::SuperLeft;
+            case XK_Super_R: return KeyCode::SuperRight;
+            case XK_Caps_Lock: return KeyCode::CapsLock;
+            case XK_Num_Lock: return KeyCode::NumLock;
+            case XK_Scroll_Lock: return KeyCode::ScrollLock;
+            case XK_ISO_Level3_Shift: return KeyCode::RightAlt; // AltGr
+
+            // Numpad (Non-Digits)
+            case XK_KP_Enter: return KeyCode::NumpadEnter;
+            case XK_KP_Multiply: return KeyCode::NumpadMultiply;
+            case XK_KP_Add: return KeyCode::NumpadAdd;
+            case XK_KP_Subtract: return KeyCode::NumpadSubtract;
+            case XK_KP_Decimal: return KeyCode::NumpadDecimal;
+            case XK_KP_Divide: return KeyCode::NumpadDivide;
+            case XK_KP_Equal: return KeyCode::NumpadEqual;
+
+            // Numpad Navigation (When NumLock is off)
+            case XK_KP_Insert: return KeyCode::Numpad0;
+            case XK_KP_End: return KeyCode::Numpad1;
+            case XK_KP_Down: return KeyCode::Numpad2;
+            case XK_KP_Page_Down: return KeyCode::Numpad3;
+            case XK_KP_Left: return KeyCode::Numpad4;
+            case XK_KP_Begin: return KeyCode::Numpad5;
+            case XK_KP_Right: return KeyCode::Numpad6;
+            case XK_KP_Home: return KeyCode::Numpad7;
+            case XK_KP_Up: return KeyCode::Numpad8;
+            case XK_KP_Page_Up: return KeyCode::Numpad9;
+            case XK_KP_Delete: return KeyCode::NumpadDecimal;
+
+            // Symbols (Standard US Layout & Shifted Variants)
+
+            // Key: ` ~
+            case XK_grave: return KeyCode::Grave;
+            case XK_asciitilde: return KeyCode::Grave;
+
+            // Key: - _
+            case XK_minus: return KeyCode::Minus;
+            case XK_underscore: return KeyCode::Minus;
+
+            // Key: = +
+            case XK_equal: return KeyCode::Equal;
+            case XK_plus: return KeyCode::Equal;
+
+            // Key: [ {
+            case XK_bracketleft: return KeyCode::BracketLeft;
+            case XK_braceleft: return KeyCode::BracketLeft;
+
+            // Key: ] }
+            case XK_bracketright: return KeyCode::BracketRight;
+            case XK_braceright: return KeyCode::BracketRight;
+
+            // Key: ; :
+            case XK_semicolon: return KeyCode::Semicolon;
+            case XK_colon: return KeyCode::Semicolon;
+
+            // Key: ' "
+            case XK_apostrophe: return KeyCode::Apostrophe;
+            case XK_quotedbl: return KeyCode::Apostrophe;
+
+            // Key: , <
+            case XK_comma: return KeyCode::Comma;
+            case XK_less: return KeyCode::Comma;
+
+            // Key: . >
+            case XK_period: return KeyCode::Period;
+            case XK_greater: return KeyCode::Period;
+
+            // Key: / ?
+            case XK_slash: return KeyCode::Slash;
+            case XK_question: return KeyCode::Slash;
+
+            // Key: \ |
+            case XK_backslash: return KeyCode::Backslash;
+            case XK_bar: return KeyCode::Backslash;
+
+            // Shifted Numbers (US Layout)
+            case XK_exclam: return KeyCode::Num1;
+            case XK_at: return KeyCode::Num2;
+            case XK_numbersign: return KeyCode::Num3;
+            case XK_dollar: return KeyCode::Num4;
+            case XK_percent: return KeyCode::Num5;
+            case XK_asciicircum: return KeyCode::Num6;
+            case XK_ampersand: return KeyCode::Num7;
+            case XK_asterisk: return KeyCode::Num8;
+            case XK_parenleft: return KeyCode::Num9;
+            case XK_parenright: return KeyCode::Num0;
+
+            // Custom/International Mappings
+            case XK_ecaron: return KeyCode::Num2;
+            case XK_scaron: return KeyCode::Num3;
+            case XK_ccaron: return KeyCode::Num4;
+            case XK_rcaron: return KeyCode::Num5;
+            case XK_zcaron: return KeyCode::Num6;
+            case XK_yacute: return KeyCode::Num7;
+            case XK_aacute: return KeyCode::Num8;
+            case XK_iacute: return KeyCode::Num9;
+            case XK_eacute: return KeyCode::Num0;
+            case XK_dead_acute: return KeyCode::Equal;
+            case XK_dead_diaeresis: return KeyCode::Backslash;
+            case XK_uring: return KeyCode::Semicolon;
+            case XK_section: return KeyCode::Apostrophe;
+
+            default: return KeyCode::UnsupportedKey;
+        }
+    }
+#endif
+
+    SURFER_DEF ShortcutMap::ShortcutMap(const VkAllocationCallbacks *allocator)
+        : _states(allocator), _transitions(allocator) {
+        clear();
+    }
+
+    SURFER_DEF bool ShortcutMap::bind(uint32_t action, Span<Shortcut> sequence) {
+        if (sequence.empty()) {
+            return false;
+        }
+        for (const Shortcut &shortcut: sequence) {
+            if (isModifierKey(shortcut.key) || shortcut.key == KeyCode::UnsupportedKey) {
+                return false;
             }
+        }
 
-            if (_nativeKeyPressCallback != nullptr) {
-                _nativeKeyPressCallback(keySym);
+        // Walk the trie, adding the missing states
+        uint32_t state = 0u;
+        for (const Shortcut &shortcut: sequence) {
+            const uint64_t key = transitionKey(state, shortcut.modifiers, shortcut.key);
+            uint32_t target = findTransition(key);
+            if (target == 0u) {
+                target = static_cast<uint32_t>(_states.size());
+                _states.push_back(State{NoAction, false});
+                insertTransition(key, target);
+                _states[state].hasTransitions = true;
             }
+            state = target;
+        }
+        _states[state].action = action;
+        _state = 0u;
+        return true;
+    }
+
+    SURFER_DEF void ShortcutMap::clear() {
+        _states.assign(1u, State{NoAction, false});
+        _transitions.clear();
+        _transitionCount = 0u;
+        _state = 0u;
+    }
+
+    SURFER_DEF bool ShortcutMap::onKeyPress(ModifierFlags modifiers, KeyCode key) {
+        // Modifiers are part of the next press, they must not break a chord
+        if (isModifierKey(key) || key == KeyCode::UnsupportedKey) {
+            return false;
+        }
 
-            if (_characterInputCallback != nullptr && X11_xic != nullptr) {
-                char buf[32] = {};
-                Status status;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (_state != 0u && now >= _deadline) {
+            finishChord();
+        }
 
-                // Converts key press to UTF-8 string according to layout and IME
-                int n = Xutf8LookupString(X11_xic, event, buf, sizeof(buf) - 1, nullptr, &status);
-                buf[n] = '\0';
+        uint32_t target = findTransition(transitionKey(_state, modifiers, key));
+        if (target == 0u && _state != 0u) {
+            // Broken chord, the key starts over from the root
+            finishChord();
+            target = findTransition(transitionKey(0u, modifiers, key));
+        }
+        if (target == 0u) {
+            return false;
+        }
 
-                if (status == XLookupChars || status == XLookupBoth) {
-                    _characterInputCallback(buf); // forward UTF-8 string
-                }
-            }
+        if (_states[target].hasTransitions) {
+            _state = target;
+            _deadline = now + _chordTimeout;
+        } else {
+            _state = 0u;
+            fire(_states[target].action);
         }
+        return true;
+    }
 
-        void X11_onKeyRelease(unsigned int x11KeyCode) {
-            KeySym keySym = XkbKeycodeToKeysym(X11_display, x11KeyCode, 0, 0);
-            const KeyCode transledKeyCode = X11_translateKeyCode(keySym);
+    SURFER_DEF void ShortcutMap::update() {
+        if (_state != 0u && std::chrono::steady_clock::now() >= _deadline) {
+            finishChord();
+        }
+    }
 
-            if (_keyReleaseCallback != nullptr) {
-                _keyReleaseCallback(transledKeyCode);
+    SURFER_DEF int ShortcutMap::clampTimeout(int timeout) const {
+        if (_state == 0u) {
+            return timeout;
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const int64_t remaining = _deadline <= now ? 0 :
+            std::chrono::duration_cast<std::chrono::milliseconds>(_deadline - now).count() + 1;
+        return timeout < 0 || remaining < timeout ? static_cast<int>(remaining) : timeout;
+    }
+
+    SURFER_DEF bool ShortcutMap::isModifierKey(KeyCode key) {
+        return key >= KeyCode::LeftShift && key <= KeyCode::ScrollLock;
+    }
+
+    SURFER_DEF uint64_t ShortcutMap::transitionKey(uint32_t state, ModifierFlags modifiers, KeyCode key) {
+        return (static_cast<uint64_t>(state) << 32) | (static_cast<uint64_t>(modifiers & 0xFFFFu) << 16) |
+               static_cast<uint64_t>(key);
+    }
+
+    SURFER_DEF uint32_t ShortcutMap::findTransition(uint64_t key) const {
+        if (_transitions.empty()) {
+            return 0u;
+        }
+        const size_t mask = _transitions.size() - 1u;
+        for (size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;; i = (i + 1u) & mask) {
+            if (_transitions[i].key == key) {
+                return _transitions[i].target;
             }
-
-            if (_nativeKeyReleaseCallback != nullptr) {
-                _nativeKeyReleaseCallback(keySym);
+            if (_transitions[i].key == EmptyKey) {
+                return 0u;
             }
         }
-
-        void X11_onButtonPress(unsigned int x11button) {
-            switch (x11button) {
-                // directly calls the callback as the translation function cannot translate mouse
-                case Button1: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseLeft);
-                    }
-                    break;
-                }
-                case Button2: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseRight);
-                    }
-                    break;
-                }
-                case Button3: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseMiddle);
-                    }
-                    break;
-                }
-                case Button4: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseWheelUp);
-                    }
-                    break;
-                }
-                case Button5: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::MouseWheelDown);
-                    }
-                    break;
-                }
-                default: {
-                    if (_keyPressCallback != nullptr) {
-                        _keyPressCallback(KeyCode::UnsupportedKey);
-                    }
+    }
+
+    SURFER_DEF void ShortcutMap::insertTransition(uint64_t key, uint32_t target) {
+        // Keep the table at most half full so probes stay short
+        if ((_transitionCount + 1u) * 2u > _transitions.size()) {
+            Vector<Transition> old(_transitions.get_allocator());
+            old.swap(_transitions);
+            _transitions.assign(old.empty() ? 64u : old.size() * 2u, Transition{EmptyKey, 0u});
+            _transitionCount = 0u;
+            for (const Transition &transition: old) {
+                if (transition.key != EmptyKey) {
+                    insertTransition(transition.key, transition.target);
                 }
             }
         }
 
-        void X11_onButtonRelease(unsigned int x11button) {
-            switch (x11button) {
-                // directly calls the callback as the translation function cannot translate mouse
-                case Button1: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseLeft);
-                    }
-                    break;
-                }
-                case Button2: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseRight);
-                    }
-                    break;
-                }
-                case Button3: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseMiddle);
-                    }
-                    break;
-                }
-                case Button4: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseWheelUp);
-                    }
-                    break;
-                }
-                case Button5: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::MouseWheelDown);
-                    }
-                    break;
-                }
-                default: {
-                    if (_keyReleaseCallback != nullptr) {
-                        _keyReleaseCallback(KeyCode::UnsupportedKey);
-                    }
-                }
+        const size_t mask = _transitions.size() - 1u;
+        size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (_transitions[i].key != EmptyKey) {
+            i = (i + 1u) & mask;
+        }
+        _transitions[i].key = key;
+        _transitions[i].target = target;
+        _transitionCount++;
+    }
+
+    SURFER_DEF void ShortcutMap::finishChord() {
+        const uint32_t action = _states[_state].action;
+        _state = 0u;
+        fire(action);
+    }
+
+    SURFER_DEF void ShortcutMap::fire(uint32_t action) {
+        if (action != NoAction && _actionCallback != nullptr) {
+            _actionCallback(action);
+        }
+    }
+
+    SURFER_DEF ActionMap::ActionMap(uint32_t actionCount, const VkAllocationCallbacks *allocator)
+        : _actionCount(actionCount), _keyTerms(allocator), _buttonTerms(allocator), _axisTerms(allocator),
+          _values(actionCount, 0.0f, allocator), _down((actionCount + 63u) / 64u, 0u, allocator),
+          _pressed((actionCount + 63u) / 64u, 0u, allocator), _released((actionCount + 63u) / 64u, 0u, allocator) {
+    }
+
+    SURFER_DEF bool ActionMap::bindKey(uint32_t action, KeyCode key, float scale) {
+        if (action >= _actionCount || key == KeyCode::UnsupportedKey || key == KeyCode::MouseWheelUp ||
+            key == KeyCode::MouseWheelDown) {
+            return false;
+        }
+        const uint32_t index = static_cast<uint32_t>(key);
+        for (KeyTerm &term: _keyTerms) {
+            if (term.action == action && term.scale == scale) {
+                term.mask[index / 64u] |= uint64_t(1) << (index % 64u);
+                return true;
             }
         }
-
-        void X11_onMove(int32_t x, int32_t y) {
-            _x = x;
-            _y = y;
-
-            if (_moveCallback != nullptr) {
-                _moveCallback(x, y);
+        KeyTerm term = {};
+        term.mask[index / 64u] = uint64_t(1) << (index % 64u);
+        term.action = action;
+        term.scale = scale;
+        _keyTerms.push_back(term);
+        return true;
+    }
+
+    SURFER_DEF bool ActionMap::bindGamepadButton(uint32_t action, uint32_t gamepad, GamepadButton button, float scale) {
+        if (action >= _actionCount || gamepad >= MaxGamepads || button == GamepadButton::UnsupportedButton) {
+            return false;
+        }
+        const uint32_t bit = 1u << static_cast<uint32_t>(button);
+        _usesGamepads = true;
+        for (ButtonTerm &term: _buttonTerms) {
+            if (term.action == action && term.gamepad == gamepad && term.scale == scale) {
+                term.mask |= bit;
+                return true;
             }
         }
+        _buttonTerms.push_back(ButtonTerm{bit, gamepad, action, scale});
+        return true;
+    }
 
-        void X11_onResize(const uint32_t width, const uint32_t height) {
-            // save the internal state
-            _width = width;
-            _height = height;
-
-            if (_resizeCallback != nullptr) {
-                _resizeCallback(width, height);
+    SURFER_DEF bool ActionMap::bindGamepadAxis(uint32_t action, uint32_t gamepad, GamepadAxis axis, float scale) {
+        if (action >= _actionCount || gamepad >= MaxGamepads || axis == GamepadAxis::UnsupportedAxis) {
+            return false;
+        }
+        _usesGamepads = true;
+        _axisTerms.push_back(AxisTerm{static_cast<uint32_t>(axis), gamepad, action, scale});
+        return true;
+    }
+
+    SURFER_DEF bool ActionMap::bindWheel(uint32_t action, float scale) {
+        if (action >= _actionCount) {
+            return false;
+        }
+        _axisTerms.push_back(AxisTerm{WheelSource, 0u, action, scale});
+        return true;
+    }
+
+    SURFER_DEF void ActionMap::clear() {
+        _keyTerms.clear();
+        _buttonTerms.clear();
+        _axisTerms.clear();
+        _usesGamepads = false;
+    }
+
+    SURFER_DEF void ActionMap::update(const Window &window) {
+        GamepadState gamepads[MaxGamepads];
+        const uint32_t gamepadCount = _usesGamepads ? MaxGamepads : 0u;
+        for (uint32_t i = 0; i < gamepadCount; i++) {
+            window.getGamepadState(i, gamepads[i]);
+        }
+        update(window.getState(), Span<GamepadState>(gamepads, gamepadCount));
+    }
+
+    SURFER_DEF void ActionMap::update(const WindowState &state, Span<GamepadState> gamepads) {
+        std::fill(_values.begin(), _values.end(), 0.0f);
+        std::fill(_pressed.begin(), _pressed.end(), 0u);
+
+        // Keys pressed during the poll count as held, so taps shorter than a poll are not lost
+        for (const KeyTerm &term: _keyTerms) {
+            uint64_t held = 0u, pressed = 0u;
+            for (uint32_t i = 0; i < KeyWordCount; i++) {
+                held |= (state.keys[i] | state.pressedKeys[i]) & term.mask[i];
+                pressed |= state.pressedKeys[i] & term.mask[i];
             }
+            _values[term.action] += static_cast<float>(held != 0u) * term.scale;
+            _pressed[term.action / 64u] |= static_cast<uint64_t>(pressed != 0u) << (term.action % 64u);
         }
 
-        void X11_onMouseMotion(uint32_t x, uint32_t y) {
-            if (_mouse_x != x || _mouse_y != y) {
-                // save the internal state
-                _mouse_x = x;
-                _mouse_y = y;
+        const GamepadState disconnected = {};
+        for (const ButtonTerm &term: _buttonTerms) {
+            const GamepadState &gamepad = term.gamepad < gamepads.size ? gamepads[term.gamepad] : disconnected;
+            _values[term.action] += static_cast<float>((gamepad.buttons & term.mask) != 0u) * term.scale;
+        }
 
-                if (_mouseMotionCallback != nullptr) {
-                    _mouseMotionCallback(x, y);
-                }
+        for (const AxisTerm &term: _axisTerms) {
+            float value;
+            if (term.source == WheelSource) {
+                value = state.wheel;
+            } else {
+                value = term.gamepad < gamepads.size ? gamepads[term.gamepad].axes[term.source] : 0.0f;
             }
+            _values[term.action] += value * term.scale;
         }
 
-        void X11_onFocusIn() {
-            _focused = true;
-            if (_focusCallback != nullptr) {
-                _focusCallback(true);
+        // Edges from the previous down bits, a key released and pressed again within the poll is a press as well
+        for (uint32_t word = 0; word < _down.size(); word++) {
+            uint64_t down = 0u;
+            const uint32_t end = std::min(_actionCount, (word + 1u) * 64u);
+            for (uint32_t action = word * 64u; action < end; action++) {
+                down |= static_cast<uint64_t>(_values[action] != 0.0f) << (action % 64u);
             }
+            _pressed[word] = (down & ~_down[word]) | (_pressed[word] & down);
+            _released[word] = ~down & _down[word];
+            _down[word] = down;
+        }
+    }
+
+    SURFER_DEF Swapchain *Swapchain::createSwapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device,
+                                                     VkSurfaceKHR surface, const SwapchainSettings &settings) {
+        Swapchain *swapchain = nullptr;
+        tryCreateSwapchain(window, physicalDevice, device, surface, &swapchain, settings);
+#if !defined(SURFER_NO_EXCEPTIONS)
+        if (swapchain == nullptr) {
+            throw std::runtime_error("VulkanSurfer: Failed to create swapchain");
+        }
+#endif
+        return swapchain;
+    }
+
+    SURFER_DEF VkResult Swapchain::tryCreateSwapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device,
+                                                      VkSurfaceKHR surface, Swapchain **out,
+                                                      const SwapchainSettings &settings) {
+        *out = nullptr;
+        const VkAllocationCallbacks *allocator = window->getAllocationCallbacks();
+        void *memory = allocateMemory(allocator, sizeof(Swapchain), alignof(Swapchain));
+        if (memory == nullptr) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+        Swapchain *swapchain = new(memory) Swapchain(window, physicalDevice, device, surface, settings);
+
+#if defined(SURFER_NO_EXCEPTIONS)
+        const VkResult result = swapchain->recreate();
+#else
+        VkResult result;
+        try {
+            result = swapchain->recreate();
+        } catch (const std::bad_alloc &) {
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+#endif
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            destroySwapchain(swapchain);
+            return result;
         }
+        *out = swapchain;
+        return result;
+    }
 
-        void X11_onFocusOut() {
-            _focused = false;
-            if (_focusCallback != nullptr) {
-                _focusCallback(false);
+    SURFER_DEF void Swapchain::destroySwapchain(const Swapchain *swapchain) {
+        if (swapchain == nullptr) {
+            return;
+        }
+        // The window outlives the swapchain, so its callbacks are still valid
+        const VkAllocationCallbacks *allocator = swapchain->_allocator;
+        swapchain->~Swapchain();
+        freeMemory(allocator, const_cast<Swapchain *>(swapchain));
+    }
+
+    SURFER_DEF VkResult Swapchain::acquireNextImage(VkSemaphore semaphore, VkFence fence, uint32_t *imageIndex) {
+        collectRetired();
+
+        unsigned int width, height;
+        _window->getWindowSize(width, height);
+        if (_swapchain == VK_NULL_HANDLE || _recreate || width != _windowWidth || height != _windowHeight) {
+            const VkResult result = recreate();
+            if (result != VK_SUCCESS) {
+                return result;
             }
         }
 
-        void X11_onMouseEnter() {
-            _mouseEntered = true;
-            if (_mouseEnterExitCallback != nullptr) {
-                _mouseEnterExitCallback(true);
+        VkResult result = vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, semaphore, fence, imageIndex);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Nothing was signaled, try once more with a fresh swapchain
+            result = recreate();
+            if (result != VK_SUCCESS) {
+                return result;
             }
+            result = vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, semaphore, fence, imageIndex);
+        }
+        if (result == VK_SUBOPTIMAL_KHR) {
+            // The image is still presentable, recreate on the next acquire
+            _recreate = true;
         }
+        return result;
+    }
 
-        void X11_onMouseLeave() {
-            _mouseEntered = false;
-            if (_mouseEnterExitCallback != nullptr) {
-                _mouseEnterExitCallback(false);
-            }
+    SURFER_DEF VkResult Swapchain::present(VkQueue queue, VkSemaphore semaphore, uint32_t imageIndex, VkFence fence) {
+        if (fence != VK_NULL_HANDLE && std::find(_fences.begin(), _fences.end(), fence) == _fences.end()) {
+            _fences.push_back(fence);
         }
 
-        KeyCode X11_translateKeyCode(KeySym keySym) {
-            // Contiguous Ranges
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = semaphore != VK_NULL_HANDLE ? 1u : 0u;
+        presentInfo.pWaitSemaphores = &semaphore;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = &_swapchain;
+        presentInfo.pImageIndices = &imageIndex;
+
+        const VkResult result = vkQueuePresentKHR(queue, &presentInfo);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            _recreate = true;
+            return VK_SUCCESS;
+        }
+        return result;
+    }
+
+    SURFER_DEF Swapchain::Swapchain(Window *window, VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface,
+                                    const SwapchainSettings &settings)
+        : _window(window), _allocator(window->getAllocationCallbacks()), _physicalDevice(physicalDevice), _device(device),
+          _surface(surface), _settings(settings), _images(_allocator), _fences(_allocator), _retired(_allocator) {
+    }
+
+    SURFER_DEF Swapchain::~Swapchain() {
+        // No waiting here, destroySwapchain requires the device to be done with all images
+        for (const Retired &retired: _retired) {
+            vkDestroySwapchainKHR(_device, retired.swapchain, _allocator);
+        }
+        if (_swapchain != VK_NULL_HANDLE) {
+            vkDestroySwapchainKHR(_device, _swapchain, _allocator);
+        }
+    }
+
+    SURFER_DEF void Swapchain::collectRetired() {
+        for (size_t i = 0; i < _retired.size();) {
+            // Nothing fenced was presented to it (fence omitted, or recreated before the first present). Frames in
+            // flight may still use its images, so wait for frames submitted later, they signal after the earlier ones.
+            if (_retired[i].fences.empty()) {
+                _retired[i].fences.assign(_fences.begin(), _fences.end());
+                if (_retired[i].fences.empty()) {
+                    for (size_t j = i + 1; j < _retired.size() && _retired[i].fences.empty(); j++) {
+                        _retired[i].fences.assign(_retired[j].fences.begin(), _retired[j].fences.end());
+                    }
+                }
+                if (_retired[i].fences.empty()) {
+                    i++;
+                    continue;
+                }
+            }
 
-            // Alphabet (a-z, A-Z)
-            if (keySym >= XK_a && keySym <= XK_z) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (keySym - XK_a));
+            bool done = true;
+            for (VkFence fence: _retired[i].fences) {
+                if (vkGetFenceStatus(_device, fence) != VK_SUCCESS) {
+                    done = false;
+                    break;
+                }
             }
-            if (keySym >= XK_A && keySym <= XK_Z) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::KeyA) + (keySym - XK_A));
+            if (done) {
+                vkDestroySwapchainKHR(_device, _retired[i].swapchain, _allocator);
+                _retired.erase(_retired.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                i++;
             }
-
-            // Numbers (0-9)
-            if (keySym >= XK_0 && keySym <= XK_9) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Num0) + (keySym - XK_0));
+        }
+    }
+
+    SURFER_DEF VkSurfaceFormatKHR Swapchain::chooseFormat(Span<VkSurfaceFormatKHR> formats) const {
+        for (const VkSurfaceFormatKHR &format: formats) {
+            const bool srgb = format.format == VK_FORMAT_B8G8R8A8_SRGB || format.format == VK_FORMAT_R8G8B8A8_SRGB;
+            const bool unorm = format.format == VK_FORMAT_B8G8R8A8_UNORM || format.format == VK_FORMAT_R8G8B8A8_UNORM;
+            if ((_settings.srgb ? srgb : unorm) && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+                return format;
             }
-
-            // Numpad Numbers (0-9)
-            if (keySym >= XK_KP_0 && keySym <= XK_KP_9) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::Numpad0) + (keySym - XK_KP_0));
+        }
+        return formats[0];
+    }
+
+    SURFER_DEF VkPresentModeKHR Swapchain::choosePresentMode(Span<VkPresentModeKHR> presentModes) const {
+        // Preferred modes in order, FIFO is always supported
+        VkPresentModeKHR preferred[2] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_KHR};
+        switch (_settings.latency) {
+            case PresentLatency::VSync: break;
+            case PresentLatency::LowLatency: preferred[0] = VK_PRESENT_MODE_MAILBOX_KHR; break;
+            case PresentLatency::Uncapped:
+                preferred[0] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+                preferred[1] = VK_PRESENT_MODE_MAILBOX_KHR;
+                break;
+        }
+        for (VkPresentModeKHR mode: preferred) {
+            if (std::find(presentModes.begin(), presentModes.end(), mode) != presentModes.end()) {
+                return mode;
             }
+        }
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    SURFER_DEF VkResult Swapchain::recreate() {
+        VkSurfaceCapabilitiesKHR capabilities;
+        Span<VkSurfaceFormatKHR> formats;
+        Span<VkPresentModeKHR> presentModes;
+        VkResult result = _window->getSurfaceCapabilities(_physicalDevice, _surface, &capabilities);
+        if (result == VK_SUCCESS) {
+            result = _window->getSurfaceFormats(_physicalDevice, _surface, &formats);
+        }
+        if (result == VK_SUCCESS) {
+            result = _window->getSurfacePresentModes(_physicalDevice, _surface, &presentModes);
+        }
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        if (formats.empty()) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
 
-            // Function Keys (F1 - F12)
-            // Note: XK_F1 to XK_F12 are contiguous in X11 (0xFFBE to 0xFFC9)
-            if (keySym >= XK_F1 && keySym <= XK_F12) {
-                return static_cast<KeyCode>(static_cast<uint32_t>(KeyCode::F1) + (keySym - XK_F1));
-            }
+        _window->getWindowSize(_windowWidth, _windowHeight);
+        VkExtent2D extent = capabilities.currentExtent;
+        if (extent.width == UINT32_MAX) {
+            // The surface size is defined by the swapchain
+            extent.width = std::min(std::max(_windowWidth, capabilities.minImageExtent.width), capabilities.maxImageExtent.width);
+            extent.height = std::min(std::max(_windowHeight, capabilities.minImageExtent.height), capabilities.maxImageExtent.height);
+        }
+        if (extent.width == 0 || extent.height == 0) {
+            _recreate = true; // minimized, try again once the window has an area
+            return VK_NOT_READY;
+        }
 
-            // Specific Key Mappings
-            switch (keySym) {
-                // Arrows
-                case XK_Up: return KeyCode::ArrowUp;
-                case XK_Down: return KeyCode::ArrowDown;
-                case XK_Left: return KeyCode::ArrowLeft;
-                case XK_Right: return KeyCode::ArrowRight;
+        const VkPresentModeKHR presentMode = choosePresentMode(presentModes);
+        uint32_t imageCount = capabilities.minImageCount + (presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 2u : 1u);
+        if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+            imageCount = capabilities.maxImageCount;
+        }
 
-                // Navigation
-                case XK_Home: return KeyCode::Home;
-                case XK_End: return KeyCode::End;
-                case XK_Page_Up: return KeyCode::PageUp;
-                case XK_Page_Down: return KeyCode::PageDown;
+        const VkSurfaceFormatKHR format = chooseFormat(formats);
+        VkSwapchainCreateInfoKHR createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        createInfo.surface = _surface;
+        createInfo.minImageCount = imageCount;
+        createInfo.imageFormat = format.format;
+        createInfo.imageColorSpace = format.colorSpace;
+        createInfo.imageExtent = extent;
+        createInfo.imageArrayLayers = 1;
+        createInfo.imageUsage = _settings.usage;
+        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        createInfo.preTransform = capabilities.currentTransform;
+        createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        createInfo.presentMode = presentMode;
+        createInfo.clipped = VK_TRUE;
+        createInfo.oldSwapchain = _swapchain;
+
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        result = vkCreateSwapchainKHR(_device, &createInfo, _allocator, &swapchain);
+
+        // oldSwapchain is retired even if the creation failed
+        if (_swapchain != VK_NULL_HANDLE) {
+            Retired retired = {_swapchain, Vector<VkFence>(_allocator)};
+            retired.fences.swap(_fences);
+            _retired.push_back(std::move(retired));
+            _swapchain = VK_NULL_HANDLE;
+            _images.clear();
+        }
+        if (result != VK_SUCCESS) {
+            return result;
+        }
 
-                // Editing
-                case XK_BackSpace: return KeyCode::BackSpace;
-                case XK_Delete: return KeyCode::Delete;
-                case XK_Insert: return KeyCode::Insert;
+        uint32_t count = 0;
+        vkGetSwapchainImagesKHR(_device, swapchain, &count, nullptr);
+        _images.resize(count);
+        vkGetSwapchainImagesKHR(_device, swapchain, &count, _images.data());
 
-                // Special
-                case XK_Return: return KeyCode::Enter;
-                case XK_space: return KeyCode::Space;
-                case XK_Tab: return KeyCode::Tab;
-                case XK_Escape: return KeyCode::Esc;
-                case XK_Print: return KeyCode::PrtSc;
-                case XK_Pause: return KeyCode::Pause;
-                case XK_Break: return KeyCode::Pause;
-
-                // Modifiers
-                case XK_Shift_L: return KeyCode::LeftShift;
-                case XK_Shift_R: return KeyCode::RightShift;
-                case XK_Control_L: return KeyCode::LeftControl;
-                case XK_Control_R: return KeyCode::RightControl;
-                case XK_Alt_L: return KeyCode::LeftAlt;
-                case XK_Alt_R: return KeyCode::RightAlt;
-                case XK_Super_L: return KeyCode::SuperLeft;
-                case XK_Super_R: return KeyCode::SuperRight;
-                case XK_Caps_Lock: return KeyCode::CapsLock;
-                case XK_Num_Lock: return KeyCode::NumLock;
-                case XK_Scroll_Lock: return KeyCode::ScrollLock;
-                case XK_ISO_Level3_Shift: return KeyCode::RightAlt; // AltGr
+        _swapchain = swapchain;
+        _format = format;
+        _presentMode = presentMode;
+        _extent = extent;
+        _recreate = false;
 
-                // Numpad (Non-Digits)
-                case XK_KP_Enter: return KeyCode::NumpadEnter;
-                case XK_KP_Multiply: return KeyCode::NumpadMultiply;
-                case XK_KP_Add: return KeyCode::NumpadAdd;
-                case XK_KP_Subtract: return KeyCode::NumpadSubtract;
-                case XK_KP_Decimal: return KeyCode::NumpadDecimal;
-                case XK_KP_Divide: return KeyCode::NumpadDivide;
-                case XK_KP_Equal: return KeyCode::NumpadEqual;
-
-                // Numpad Navigation (When NumLock is off)
-                case XK_KP_Insert: return KeyCode::Numpad0;
-                case XK_KP_End: return KeyCode::Numpad1;
-                case XK_KP_Down: return KeyCode::Numpad2;
-                case XK_KP_Page_Down: return KeyCode::Numpad3;
-                case XK_KP_Left: return KeyCode::Numpad4;
-                case XK_KP_Begin: return KeyCode::Numpad5;
-                case XK_KP_Right: return KeyCode::Numpad6;
-                case XK_KP_Home: return KeyCode::Numpad7;
-                case XK_KP_Up: return KeyCode::Numpad8;
-                case XK_KP_Page_Up: return KeyCode::Numpad9;
-                case XK_KP_Delete: return KeyCode::NumpadDecimal;
-
-                // Symbols (Standard US Layout & Shifted Variants)
-
-                // Key: ` ~
-                case XK_grave: return KeyCode::Grave;
-                case XK_asciitilde: return KeyCode::Grave;
-
-                // Key: - _
-                case XK_minus: return KeyCode::Minus;
-                case XK_underscore: return KeyCode::Minus;
-
-                // Key: = +
-                case XK_equal: return KeyCode::Equal;
-                case XK_plus: return KeyCode::Equal;
-
-                // Key: [ {
-                case XK_bracketleft: return KeyCode::BracketLeft;
-                case XK_braceleft: return KeyCode::BracketLeft;
-
-                // Key: ] }
-                case XK_bracketright: return KeyCode::BracketRight;
-                case XK_braceright: return KeyCode::BracketRight;
-
-                // Key: ; :
-                case XK_semicolon: return KeyCode::Semicolon;
-                case XK_colon: return KeyCode::Semicolon;
-
-                // Key: ' "
-                case XK_apostrophe: return KeyCode::Apostrophe;
-                case XK_quotedbl: return KeyCode::Apostrophe;
-
-                // Key: , <
-                case XK_comma: return KeyCode::Comma;
-                case XK_less: return KeyCode::Comma;
-
-                // Key: . >
-                case XK_period: return KeyCode::Period;
-                case XK_greater: return KeyCode::Period;
-
-                // Key: / ?
-                case XK_slash: return KeyCode::Slash;
-                case XK_question: return KeyCode::Slash;
-
-                // Key: \ |
-                case XK_backslash: return KeyCode::Backslash;
-                case XK_bar: return KeyCode::Backslash;
-
-                // Shifted Numbers (US Layout)
-                case XK_exclam: return KeyCode::Num1;
-                case XK_at: return KeyCode::Num2;
-                case XK_numbersign: return KeyCode::Num3;
-                case XK_dollar: return KeyCode::Num4;
-                case XK_percent: return KeyCode::Num5;
-                case XK_asciicircum: return KeyCode::Num6;
-                case XK_ampersand: return KeyCode::Num7;
-                case XK_asterisk: return KeyCode::Num8;
-                case XK_parenleft: return KeyCode::Num9;
-                case XK_parenright: return KeyCode::Num0;
-
-                // Custom/International Mappings
-                case XK_ecaron: return KeyCode::Num2;
-                case XK_scaron: return KeyCode::Num3;
-                case XK_ccaron: return KeyCode::Num4;
-                case XK_rcaron: return KeyCode::Num5;
-                case XK_zcaron: return KeyCode::Num6;
-                case XK_yacute: return KeyCode::Num7;
-                case XK_aacute: return KeyCode::Num8;
-                case XK_iacute: return KeyCode::Num9;
-                case XK_eacute: return KeyCode::Num0;
-                case XK_dead_acute: return KeyCode::Equal;
-                case XK_dead_diaeresis: return KeyCode::Backslash;
-                case XK_uring: return KeyCode::Semicolon;
-                case XK_section: return KeyCode::Apostrophe;
-
-                default: return KeyCode::UnsupportedKey;
-            }
+        if (_recreateCallback != nullptr) {
+            _recreateCallback(*this);
         }
-
-
-#endif
-    };
+        return VK_SUCCESS;
+    }
 }
-
-#endif //VULKANSURFER_H
+#endif //VULKANSURFER_IMPLEMENTATION_H
+#endif
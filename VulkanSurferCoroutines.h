@@ -0,0 +1,212 @@
+/// Copyright(C) by Matěj Eliáš - matejelias.cz
+/// This code is licensed under the MIT license(MIT) (http://opensource.org/licenses/MIT)
+
+#ifndef VULKANSURFER_COROUTINES_H
+#define VULKANSURFER_COROUTINES_H
+
+// Opt-in C++20 coroutine layer, VulkanSurfer.h itself stays C++11
+#include "VulkanSurfer.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+
+// Size of a pooled coroutine frame in bytes including its owner header, larger frames fall back to the heap
+#ifndef SURFER_COROUTINE_FRAME_SIZE
+#define SURFER_COROUTINE_FRAME_SIZE 512
+#endif
+
+// Number of pooled coroutine frames per thread
+#ifndef SURFER_COROUTINE_FRAME_COUNT
+#define SURFER_COROUTINE_FRAME_COUNT 64
+#endif
+
+namespace Surfer {
+    /**
+     * Preallocated coroutine frames, one pool per thread. Every frame starts with a header naming the pool it came
+     * from, a frame released on another thread goes back to that pool through a lock-free list which the owner
+     * drains once its own free list runs dry. The owning thread has to outlive its tasks.
+     */
+    class CoroutineFramePool {
+    public:
+        static void *allocate(size_t size) {
+            Storage &storage = getStorage();
+            if (size <= SURFER_COROUTINE_FRAME_SIZE - sizeof(FrameHeader)) {
+                if (storage.free == nullptr) {
+                    storage.free = storage.remoteFree.exchange(nullptr, std::memory_order_acquire);
+                }
+                if (storage.free != nullptr) {
+                    FreeFrame *frame = storage.free;
+                    storage.free = frame->next;
+                    return frame;
+                }
+            }
+            FrameHeader *header = static_cast<FrameHeader *>(::operator new(sizeof(FrameHeader) + size));
+            header->owner = nullptr;
+            return header + 1;
+        }
+
+        static void deallocate(void *frame) {
+            FrameHeader *header = static_cast<FrameHeader *>(frame) - 1;
+            Storage *owner = header->owner;
+            if (owner == nullptr) {
+                ::operator delete(header);
+                return;
+            }
+
+            FreeFrame *freeFrame = static_cast<FreeFrame *>(frame);
+            if (owner == &getStorage()) {
+                freeFrame->next = owner->free;
+                owner->free = freeFrame;
+                return;
+            }
+
+            // Released on another thread, the owner picks it up on its next allocation
+            freeFrame->next = owner->remoteFree.load(std::memory_order_relaxed);
+            while (!owner->remoteFree.compare_exchange_weak(freeFrame->next, freeFrame, std::memory_order_release,
+                                                            std::memory_order_relaxed)) {
+            }
+        }
+
+    private:
+        struct Storage;
+
+        // In front of every frame, nullptr for frames from the heap
+        struct alignas(std::max_align_t) FrameHeader {
+            Storage *owner;
+        };
+
+        struct FreeFrame {
+            FreeFrame *next;
+        };
+
+        static_assert(SURFER_COROUTINE_FRAME_SIZE % alignof(std::max_align_t) == 0,
+                      "SURFER_COROUTINE_FRAME_SIZE has to keep the frames aligned");
+        static_assert(SURFER_COROUTINE_FRAME_SIZE > sizeof(FrameHeader),
+                      "SURFER_COROUTINE_FRAME_SIZE has to leave room after the frame header");
+
+        struct Storage {
+            alignas(std::max_align_t) unsigned char frames[SURFER_COROUTINE_FRAME_COUNT][SURFER_COROUTINE_FRAME_SIZE];
+            FreeFrame *free = nullptr;
+            std::atomic<FreeFrame *> remoteFree{nullptr};
+
+            Storage() {
+                for (size_t i = SURFER_COROUTINE_FRAME_COUNT; i-- > 0;) {
+                    FrameHeader *header = reinterpret_cast<FrameHeader *>(frames[i]);
+                    header->owner = this;
+                    FreeFrame *frame = reinterpret_cast<FreeFrame *>(header + 1);
+                    frame->next = free;
+                    free = frame;
+                }
+            }
+        };
+
+        static Storage &getStorage() {
+            thread_local Storage storage;
+            return storage;
+        }
+    };
+
+    /**
+     * Fire-and-forget coroutine driven by the window event loop. It starts right away, is resumed from
+     * pollEvents/waitEvents when what it awaits happens and releases its frame when it returns.
+     */
+    struct Task {
+        struct promise_type {
+            Task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+
+            static void *operator new(size_t size) { return CoroutineFramePool::allocate(size); }
+            static void operator delete(void *frame, size_t) { CoroutineFramePool::deallocate(frame); }
+        };
+    };
+
+    inline void resumeWaitingCoroutine(EventWaiter *waiter) {
+        std::coroutine_handle<>::from_address(waiter->context).resume();
+    }
+
+    // The window was destroyed, the coroutine never continues. Destroying it releases its frame.
+    inline void cancelWaitingCoroutine(EventWaiter *waiter) {
+        std::coroutine_handle<>::from_address(waiter->context).destroy();
+    }
+
+    /**
+     * Awaiter of Window::nextKey(), lives in the coroutine frame so waiting does not allocate
+     */
+    class KeyAwaiter {
+    public:
+        explicit KeyAwaiter(Window *window) : _window(window) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            _waiter.resume = &resumeWaitingCoroutine;
+            _waiter.cancel = &cancelWaitingCoroutine;
+            _waiter.context = handle.address();
+            _window->addKeyWaiter(&_waiter);
+        }
+
+        KeyCode await_resume() const noexcept { return _waiter.key; }
+
+    private:
+        Window *_window;
+        EventWaiter _waiter{};
+    };
+
+    /**
+     * Awaiter of Window::resized(), resolves to the new window size
+     */
+    class ResizeAwaiter {
+    public:
+        explicit ResizeAwaiter(Window *window) : _window(window) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            _waiter.resume = &resumeWaitingCoroutine;
+            _waiter.cancel = &cancelWaitingCoroutine;
+            _waiter.context = handle.address();
+            _window->addResizeWaiter(&_waiter);
+        }
+
+        VkExtent2D await_resume() const noexcept { return VkExtent2D{_waiter.width, _waiter.height}; }
+
+    private:
+        Window *_window;
+        EventWaiter _waiter{};
+    };
+
+    /**
+     * Awaiter of Window::sleepFor()
+     */
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(Window *window, uint32_t milliseconds) : _window(window), _milliseconds(milliseconds) {}
+
+        bool await_ready() const noexcept { return _milliseconds == 0; }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            _waiter.resume = &resumeWaitingCoroutine;
+            _waiter.cancel = &cancelWaitingCoroutine;
+            _waiter.context = handle.address();
+            _waiter.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_milliseconds);
+            _window->addTimerWaiter(&_waiter);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        Window *_window;
+        uint32_t _milliseconds;
+        EventWaiter _waiter{};
+    };
+
+    inline KeyAwaiter operator co_await(KeyWait wait) noexcept { return KeyAwaiter(wait.window); }
+    inline ResizeAwaiter operator co_await(ResizeWait wait) noexcept { return ResizeAwaiter(wait.window); }
+    inline SleepAwaiter operator co_await(SleepWait wait) noexcept { return SleepAwaiter(wait.window, wait.milliseconds); }
+}
+
+#endif //VULKANSURFER_COROUTINES_H
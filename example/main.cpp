@@ -36,16 +36,10 @@ VkResult createVulkanInstance(VkInstance *instance) {
     createInfo.pApplicationInfo = &appInfo;
 
 
-    const char* extensions[] = {
-        VK_KHR_SURFACE_EXTENSION_NAME,
-#if defined(SURFER_PLATFORM_WIN32)
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME
-#elif defined(SURFER_PLATFORM_X11)
-        VK_KHR_XLIB_SURFACE_EXTENSION_NAME
-#endif
-    };
-    createInfo.enabledExtensionCount = sizeof(extensions) / sizeof(extensions[0]);
-    createInfo.ppEnabledExtensionNames = extensions;
+    // Extensions needed by Window::createSurface
+    const Surfer::Span<const char *> extensions = Surfer::Window::getRequiredInstanceExtensions();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size);
+    createInfo.ppEnabledExtensionNames = extensions.data;
 
     const char* validationLayers[] = {
         "VK_LAYER_KHRONOS_validation"
@@ -66,8 +60,14 @@ int main() {
         return EXIT_FAILURE;
     }
 
-    // Create window
-    auto window = Surfer::Window::createWindow("Example window", 800, 600 , 100, 100 );
+    // Create window, tryCreateWindow reports failures (e.g. no display) without exceptions
+    Surfer::Window *window = nullptr;
+    const Surfer::Result result = Surfer::Window::tryCreateWindow("Example window", 800, 600, 100, 100, &window);
+    if (result != Surfer::Result::Ok) {
+        std::cout << "Failed to create window: " << Surfer::getResultString(result) << std::endl;
+        vkDestroyInstance(instance, nullptr);
+        return EXIT_FAILURE;
+    }
 
     // Now we can create a Vulkan surface
     VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -123,16 +123,30 @@ int main() {
         else {std::cout << "Window is out of focus." << std::endl;}
     });
 
+    // Dropped files arrive in batches, finished is set for the last one
+    window->registerFileDropCallback([](Surfer::Span<const char *> paths, bool finished) {
+        for (const char *path: paths) {
+            std::cout << "Dropped file: " << path << std::endl;
+        }
+        if (finished) {std::cout << "Drop finished." << std::endl;}
+    });
+
+    // Gamepads have to be enabled explicitly, register the callback first to hear about pads already plugged in
+    window->registerGamepadConnectionCallback([](uint32_t index, bool connected) {
+        std::cout << "Gamepad " << index << (connected ? " connected." : " disconnected.") << std::endl;
+    });
+    window->enableGamepads();
+
     // You can use these methods to add support any key as long as your os detects it!
 
 #ifdef SURFER_PLATFORM_X11
-    window->registerNativeKeyPressCallback([](KeySym sym) {
+    window->registerNativeKeyPressCallback([](Surfer::X11::KeySym sym) {
         std::cout << "Native key: " << sym << std::endl;
     });
 #endif
 
 #ifdef SURFER_PLATFORM_WIN32
-    window->registerNativeKeyPressCallback([](WPARAM sym) {
+    window->registerNativeKeyPressCallback([](Surfer::Win32::WPARAM sym) {
         //std::cout << "Native key: " << sym << std::endl;
     });
 #endif
@@ -29,8 +29,20 @@ struct ImGui_ImplVulkanSurfer_Data {
     std::vector<MouseButtonEvent> MouseButtonEvents;
     std::vector<MousePosEvent> MousePosEvents;
     ImVec2 DisplaySize;
+
+    // Idle tracking
+    bool DisplaySizeChanged;
+    bool FocusChanged;
+    bool Focused;
+    int RedrawFrames; // ImGui needs a few frames to settle (hover, nav, popups) after any input
+    std::chrono::time_point<std::chrono::high_resolution_clock> AnimationDeadline;
 };
 
+// Number of frames rendered after the last input before the backend reports the UI as idle
+#ifndef IMGUI_IMPL_VULKANSURFER_REDRAW_FRAMES
+#define IMGUI_IMPL_VULKANSURFER_REDRAW_FRAMES 3
+#endif
+
 // Use a static pointer to keep the state local to the translation unit
 inline ImGui_ImplVulkanSurfer_Data *g_VulkanSurferData = nullptr;
 
@@ -182,6 +194,11 @@ inline int ImGui_ImplVulkanSurfer_KeyToMouseButton(Surfer::KeyCode key) {
     }
 }
 
+// Helper: Mark UI as dirty so the next few frames get rendered
+inline void ImGui_ImplVulkanSurfer_MarkDirty() {
+    g_VulkanSurferData->RedrawFrames = IMGUI_IMPL_VULKANSURFER_REDRAW_FRAMES;
+}
+
 // API Implementation
 
 inline bool ImGui_ImplVulkanSurfer_Init(Surfer::Window *window) {
@@ -197,6 +214,11 @@ inline bool ImGui_ImplVulkanSurfer_Init(Surfer::Window *window) {
     g_VulkanSurferData->Window = window;
     g_VulkanSurferData->Time = std::chrono::high_resolution_clock::now();
     g_VulkanSurferData->DisplaySize = ImVec2(static_cast<float>(width), static_cast<float>(height));
+    g_VulkanSurferData->DisplaySizeChanged = false;
+    g_VulkanSurferData->FocusChanged = false;
+    g_VulkanSurferData->Focused = true;
+    g_VulkanSurferData->RedrawFrames = IMGUI_IMPL_VULKANSURFER_REDRAW_FRAMES;
+    g_VulkanSurferData->AnimationDeadline = g_VulkanSurferData->Time;
 
     io.BackendPlatformName = "imgui_impl_vulkansurfer_header_only";
     io.BackendFlags |= ImGuiBackendFlags_HasMouseCursors;
@@ -244,11 +266,24 @@ inline bool ImGui_ImplVulkanSurfer_Init(Surfer::Window *window) {
     window->registerResizeCallback([](int width, int height) {
         if (g_VulkanSurferData) {
             g_VulkanSurferData->DisplaySize = ImVec2((float) width, (float) height);
+            g_VulkanSurferData->DisplaySizeChanged = true;
+        }
+    });
+
+    // Focus Handling
+    window->registerFocusCallback([](bool focused) {
+        if (g_VulkanSurferData) {
+            g_VulkanSurferData->Focused = focused;
+            g_VulkanSurferData->FocusChanged = true;
         }
     });
 
+    // Text typed since the last poll arrives as a single utf8 string
     window->registerCharacterInputCallback([](const char * c) {
         ImGui::GetIO().AddInputCharactersUTF8(c);
+        if (g_VulkanSurferData) {
+            ImGui_ImplVulkanSurfer_MarkDirty();
+        }
     });
 
     return true;
@@ -262,12 +297,29 @@ inline void ImGui_ImplVulkanSurfer_Shutdown() {
 }
 
 inline void ImGui_ImplVulkanSurfer_NewFrame() {
+    SURFER_TRACE_ZONE("ImGui_ImplVulkanSurfer_NewFrame");
     IM_ASSERT(g_VulkanSurferData != nullptr && "Backend not initialized!");
     ImGuiIO &io = ImGui::GetIO();
 
     // Update display size
     io.DisplaySize = g_VulkanSurferData->DisplaySize;
 
+    // Any queued input keeps the UI rendering for a few more frames
+    if (!g_VulkanSurferData->KeyEvents.empty() || !g_VulkanSurferData->MouseButtonEvents.empty() ||
+        !g_VulkanSurferData->MousePosEvents.empty() || g_VulkanSurferData->DisplaySizeChanged ||
+        g_VulkanSurferData->FocusChanged) {
+        ImGui_ImplVulkanSurfer_MarkDirty();
+    } else if (g_VulkanSurferData->RedrawFrames > 0) {
+        g_VulkanSurferData->RedrawFrames--;
+    }
+    g_VulkanSurferData->DisplaySizeChanged = false;
+
+    // Process focus change
+    if (g_VulkanSurferData->FocusChanged) {
+        io.AddFocusEvent(g_VulkanSurferData->Focused);
+        g_VulkanSurferData->FocusChanged = false;
+    }
+
     // Setup Delta Time
     auto current_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<float> delta_time = current_time - g_VulkanSurferData->Time;
@@ -292,3 +344,52 @@ inline void ImGui_ImplVulkanSurfer_NewFrame() {
     }
     g_VulkanSurferData->MousePosEvents.clear();
 }
+
+/**
+ * Keeps the UI redrawing until the given time has elapsed (e.g. while an animation or a fade is running)
+ * @param seconds Time from now in seconds
+ */
+inline void ImGui_ImplVulkanSurfer_SetAnimationDeadline(float seconds) {
+    IM_ASSERT(g_VulkanSurferData != nullptr && "Backend not initialized!");
+    auto deadline = std::chrono::high_resolution_clock::now() +
+                    std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                        std::chrono::duration<float>(seconds));
+    if (deadline > g_VulkanSurferData->AnimationDeadline) {
+        g_VulkanSurferData->AnimationDeadline = deadline;
+    }
+}
+
+/**
+ * Reports whether the UI needs to be redrawn. This is the case when any events were queued since the last frame,
+ * the window was resized or changed focus, ImGui is still settling after recent input or the animation deadline
+ * has not passed yet.
+ * @return True if a new frame should be rendered
+ */
+inline bool ImGui_ImplVulkanSurfer_NeedsRedraw() {
+    IM_ASSERT(g_VulkanSurferData != nullptr && "Backend not initialized!");
+    return !g_VulkanSurferData->KeyEvents.empty() || !g_VulkanSurferData->MouseButtonEvents.empty() ||
+           !g_VulkanSurferData->MousePosEvents.empty() || g_VulkanSurferData->DisplaySizeChanged ||
+           g_VulkanSurferData->FocusChanged || g_VulkanSurferData->RedrawFrames > 0 ||
+           std::chrono::high_resolution_clock::now() < g_VulkanSurferData->AnimationDeadline;
+}
+
+/**
+ * Processes window events. If the UI does not need a redraw, this blocks until an event arrives
+ * or the animation deadline is reached, so idle tool UIs do not keep the GPU busy.
+ * Call this instead of Window::pollEvents and skip the frame if ImGui_ImplVulkanSurfer_NeedsRedraw returns false.
+ */
+inline void ImGui_ImplVulkanSurfer_WaitEvents() {
+    IM_ASSERT(g_VulkanSurferData != nullptr && "Backend not initialized!");
+    if (ImGui_ImplVulkanSurfer_NeedsRedraw()) {
+        g_VulkanSurferData->Window->pollEvents();
+        return;
+    }
+
+    auto now = std::chrono::high_resolution_clock::now();
+    if (now < g_VulkanSurferData->AnimationDeadline) {
+        std::chrono::duration<double> remaining = g_VulkanSurferData->AnimationDeadline - now;
+        g_VulkanSurferData->Window->waitEventsTimeout(remaining.count());
+    } else {
+        g_VulkanSurferData->Window->waitEvents();
+    }
+}